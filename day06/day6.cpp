@@ -1,7 +1,13 @@
 ﻿#include <algorithm>
 #include <array>
+#include <chrono>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
 #include <fstream>
 #include <numeric>
+#include <random>
+#include <vector>
 
 #include <fmt/core.h>
 
@@ -13,25 +19,147 @@ static constexpr u32 K_DAYS_PER_REPRODUCTION{ 7 };
 static constexpr u32 K_NEW_FISH_EXTRA_DAYS{ 2 };
 static constexpr u32 K_DAYS_PER_REPRODUCTION_NEW_FISH{ K_DAYS_PER_REPRODUCTION + K_NEW_FISH_EXTRA_DAYS };
 static constexpr u32 K_NUMBER_OF_DAYS{ 256 };
+static constexpr u32 K_MAX_TIMER_COUNT{ 512 };
+static constexpr size_t K_BATCH_BLOCK_SIZE{ 2048 };
+static constexpr size_t K_READ_BUFFER_SIZE{ 1 << 16 };
+static constexpr u32 K_BATCH_FIRST_HORIZON{ 80 };
+static constexpr u32 K_BATCH_FISH_PER_POPULATION{ 300 };
+static constexpr size_t K_BATCH_CHECKED_POPULATION_COUNT{ 16 };
+static constexpr u32 K_MAX_CHECKED_DAYS{ 1 << 20 };
+static constexpr u32 K_BATCH_RANDOM_SEED{ 2021 };
 
 using FishCounter = std::array<u64, K_DAYS_PER_REPRODUCTION_NEW_FISH>;
+using FishHistogram = std::vector<u64>;
 
-bool ReadInput(FishCounter& fishCounter)
+struct ReproductionModel
+{
+    u32 Period{ K_DAYS_PER_REPRODUCTION };
+    u32 NewbornDelay{ K_NEW_FISH_EXTRA_DAYS };
+    u32 Days{ K_NUMBER_OF_DAYS };
+};
+
+// Advances by one day the population descending from a single fish, indexed by its initial timer.
+// This is the recurrence of SimulateDay run on the timers backwards: a fish at timer t > 0
+// behaves like a fish at t - 1 one day later, while a fish at 0 splits into one fish at
+// period - 1 and one at timerCount - 1.
+template <typename TPopulations>
+constexpr void AdvancePopulations(TPopulations& populations, u32 period, u32 timerCount)
+{
+    u64 splittingFishPopulation{ populations[period - 1] + populations[timerCount - 1] };
+    for (u32 timer = timerCount - 1; timer > 0; --timer)
+    {
+        populations[timer] = populations[timer - 1];
+    }
+    populations[0] = splittingFishPopulation;
+}
+
+template <u32 Days, u32 Period, u32 NewbornDelay>
+struct PopulationTable
+{
+    static constexpr u32 K_TIMER_COUNT{ Period + NewbornDelay };
+    using Table = std::array<u64, K_TIMER_COUNT>;
+
+    static constexpr Table Build()
+    {
+        Table populations{};
+        for (u32 timer = 0; timer < K_TIMER_COUNT; ++timer)
+        {
+            populations[timer] = 1;
+        }
+
+        for (u32 day = 0; day < Days; ++day)
+        {
+            AdvancePopulations(populations, Period, K_TIMER_COUNT);
+        }
+
+        return populations;
+    }
+
+    static constexpr Table Populations{ Build() };
+};
+
+using DefaultPopulationTable = PopulationTable<K_NUMBER_OF_DAYS, K_DAYS_PER_REPRODUCTION, K_NEW_FISH_EXTRA_DAYS>;
+
+// Accepts only plain decimal numbers that fit in a u32, without sign or leading spaces.
+bool ReadArgumentValue(const char* text, u32& value)
+{
+    if (text[0] < '0' || text[0] > '9')
+    {
+        return false;
+    }
+
+    char* valueEnd{};
+    errno = 0;
+    unsigned long long parsedValue{ std::strtoull(text, &valueEnd, 10) };
+    if (*valueEnd != '\0' || errno == ERANGE || parsedValue > UINT32_MAX)
+    {
+        return false;
+    }
+
+    value = (u32)parsedValue;
+    return true;
+}
+
+// The timer count bounds the size of the transition matrices, which are cubic to square.
+bool ReadModel(ReproductionModel& model, int argc, char** argv, int firstArgument)
+{
+    u32* modelValues[]{ &model.Days, &model.Period, &model.NewbornDelay };
+    for (int i = firstArgument; i < argc && i - firstArgument < (int)std::size(modelValues); ++i)
+    {
+        if (!ReadArgumentValue(argv[i], *modelValues[i - firstArgument]))
+        {
+            return false;
+        }
+    }
+
+    return model.Period > 0 && (u64)model.Period + model.NewbornDelay <= K_MAX_TIMER_COUNT;
+}
+
+bool ReadInput(FishHistogram& histogram)
 {
     static const char* inputFile{ "input.txt" };
-    std::ifstream inputStream{ inputFile };
+    std::ifstream inputStream{ inputFile, std::ios::binary };
 
     bool readSucceeded{ inputStream.is_open() };
     if (readSucceeded)
     {
-        while (!inputStream.eof())
+        std::vector<char> buffer(K_READ_BUFFER_SIZE);
+        u32 daysLeft{};
+        bool hasDigits{};
+
+        auto addFish = [&histogram](u32 timer)
         {
-            char readchar{};
-            inputStream >> readchar;
-            u32 daysLeft{ (u32)(readchar - '0') };
-            ++fishCounter[daysLeft];
+            if (timer >= histogram.size())
+            {
+                histogram.resize(timer + 1, 0);
+            }
+            ++histogram[timer];
+        };
 
-            inputStream >> readchar;
+        while (inputStream)
+        {
+            inputStream.read(buffer.data(), buffer.size());
+            std::streamsize readSize{ inputStream.gcount() };
+            for (std::streamsize i = 0; i < readSize; ++i)
+            {
+                u32 digit{ (u32)(buffer[i] - '0') };
+                if (digit < 10)
+                {
+                    daysLeft = daysLeft * 10 + digit;
+                    hasDigits = true;
+                }
+                else if (hasDigits)
+                {
+                    addFish(daysLeft);
+                    daysLeft = 0;
+                    hasDigits = false;
+                }
+            }
+        }
+
+        if (hasDigits)
+        {
+            addFish(daysLeft);
         }
 
         inputStream.close();
@@ -40,34 +168,291 @@ bool ReadInput(FishCounter& fishCounter)
     return readSucceeded;
 }
 
-void SimulateDay(FishCounter& fishCounter)
+template <typename TFishCounter>
+void SimulateDay(TFishCounter& fishCounter, u32 period)
 {
+    // The rotation already moves the fish giving birth to the last timer, as their newborns.
     u64 fishGivingBirth{ fishCounter[0] };
     std::rotate(fishCounter.begin(), fishCounter.begin() + 1, fishCounter.end());
-    fishCounter[K_DAYS_PER_REPRODUCTION - 1] += fishGivingBirth;
-    fishCounter[K_DAYS_PER_REPRODUCTION_NEW_FISH - 1] = fishGivingBirth;
+    fishCounter[period - 1] += fishGivingBirth;
 }
 
-void SimulateForNDays(FishCounter& fishCounter, u32 simulationLength)
+void SimulateForNDays(std::vector<u64>& fishCounter, u32 period, u32 simulationLength)
 {
     for (u32 day = 0; day < simulationLength; ++day)
     {
-        SimulateDay(fishCounter);
+        SimulateDay(fishCounter, period);
+    }
+}
+
+// Row-major over the timers of a model: matrix[i * timerCount + j] is the number of fish at timer i
+// produced in one day by a fish at timer j.
+using TransitionMatrix = std::vector<u64>;
+
+struct TransitionPowers
+{
+    std::vector<TransitionMatrix> PowersOfTwo{};
+    u32 TimerCount{};
+};
+
+// Histograms stored timer-major so that each timer's counts are contiguous across populations.
+struct FishCounterBatch
+{
+    std::vector<std::vector<u64>> TimerCounts{};
+    size_t PopulationCount{};
+};
+
+void BuildDayTransitionMatrix(TransitionMatrix& matrix, u32 period, u32 timerCount)
+{
+    matrix.assign((size_t)timerCount * timerCount, 0);
+    std::vector<u64> singleFish(timerCount);
+    for (u32 j = 0; j < timerCount; ++j)
+    {
+        std::fill(singleFish.begin(), singleFish.end(), 0);
+        singleFish[j] = 1;
+        SimulateDay(singleFish, period);
+
+        for (u32 i = 0; i < timerCount; ++i)
+        {
+            matrix[(size_t)i * timerCount + j] = singleFish[i];
+        }
+    }
+}
+
+void MultiplyMatrices(TransitionMatrix& result, const TransitionMatrix& lhs, const TransitionMatrix& rhs, u32 timerCount)
+{
+    result.assign((size_t)timerCount * timerCount, 0);
+    for (u32 i = 0; i < timerCount; ++i)
+    {
+        u64* resultRow{ result.data() + (size_t)i * timerCount };
+        for (u32 k = 0; k < timerCount; ++k)
+        {
+            u64 lhsValue{ lhs[(size_t)i * timerCount + k] };
+            const u64* rhsRow{ rhs.data() + (size_t)k * timerCount };
+            for (u32 j = 0; j < timerCount; ++j)
+            {
+                resultRow[j] += lhsValue * rhsRow[j];
+            }
+        }
+    }
+}
+
+void BuildTransitionPowers(TransitionPowers& powers, const ReproductionModel& model, u32 maxDays)
+{
+    powers.TimerCount = model.Period + model.NewbornDelay;
+    powers.PowersOfTwo.clear();
+    BuildDayTransitionMatrix(powers.PowersOfTwo.emplace_back(), model.Period, powers.TimerCount);
+
+    while (((u64)maxDays >> powers.PowersOfTwo.size()) > 0)
+    {
+        TransitionMatrix squaredPower{};
+        MultiplyMatrices(squaredPower, powers.PowersOfTwo.back(), powers.PowersOfTwo.back(), powers.TimerCount);
+        powers.PowersOfTwo.push_back(std::move(squaredPower));
+    }
+}
+
+// Row vector (1, ..., 1) * M^days: the population descending from one fish at each timer.
+void ComputePopulationVector(std::vector<u64>& populations, const TransitionPowers& powers, u32 days)
+{
+    FMT_ASSERT(((u64)days >> powers.PowersOfTwo.size()) == 0, "Transition powers do not cover the requested day count.");
+
+    u32 timerCount{ powers.TimerCount };
+    populations.assign(timerCount, 1);
+    std::vector<u64> product(timerCount);
+    for (u32 power = 0; ((u64)days >> power) > 0; ++power)
+    {
+        if (((u64)days >> power) & 1)
+        {
+            const TransitionMatrix& matrix{ powers.PowersOfTwo[power] };
+            std::fill(product.begin(), product.end(), 0);
+            for (u32 i = 0; i < timerCount; ++i)
+            {
+                const u64* matrixRow{ matrix.data() + (size_t)i * timerCount };
+                for (u32 j = 0; j < timerCount; ++j)
+                {
+                    product[j] += populations[i] * matrixRow[j];
+                }
+            }
+            populations.swap(product);
+        }
+    }
+}
+
+void InitializeBatch(FishCounterBatch& batch, const ReproductionModel& model)
+{
+    batch.TimerCounts.assign(model.Period + model.NewbornDelay, {});
+    batch.PopulationCount = 0;
+}
+
+// The histogram must not hold timers beyond the batch's model.
+void AddToBatch(FishCounterBatch& batch, const FishHistogram& histogram)
+{
+    for (size_t timer = 0; timer < batch.TimerCounts.size(); ++timer)
+    {
+        batch.TimerCounts[timer].push_back(timer < histogram.size() ? histogram[timer] : 0);
+    }
+    ++batch.PopulationCount;
+}
+
+// fishCounts[h * PopulationCount + p] is the size of population p after dayCounts[h] days, under
+// the period and newborn delay of the model the batch was initialized with.
+void ComputeBatchFishCounts(const FishCounterBatch& batch, const ReproductionModel& model, const std::vector<u32>& dayCounts, std::vector<u64>& fishCounts)
+{
+    u32 maxDays{ dayCounts.empty() ? 0 : *std::max_element(dayCounts.begin(), dayCounts.end()) };
+    TransitionPowers powers{};
+    BuildTransitionPowers(powers, model, maxDays);
+
+    size_t populationCount{ batch.PopulationCount };
+    fishCounts.assign(dayCounts.size() * populationCount, 0);
+
+    std::vector<u64> populations{};
+    for (size_t horizon = 0; horizon < dayCounts.size(); ++horizon)
+    {
+        ComputePopulationVector(populations, powers, dayCounts[horizon]);
+
+        u64* horizonFishCounts{ fishCounts.data() + horizon * populationCount };
+        for (size_t blockStart = 0; blockStart < populationCount; blockStart += K_BATCH_BLOCK_SIZE)
+        {
+            size_t blockEnd{ std::min(blockStart + K_BATCH_BLOCK_SIZE, populationCount) };
+            for (u32 timer = 0; timer < powers.TimerCount; ++timer)
+            {
+                u64 timerPopulation{ populations[timer] };
+                const u64* timerCounts{ batch.TimerCounts[timer].data() };
+                for (size_t population = blockStart; population < blockEnd; ++population)
+                {
+                    horizonFishCounts[population] += timerPopulation * timerCounts[population];
+                }
+            }
+        }
+    }
+}
+
+template <typename TPopulationTable>
+u64 ComputeTotalFishCount(const std::array<u64, TPopulationTable::K_TIMER_COUNT>& fishCounter)
+{
+    return std::inner_product(fishCounter.begin(), fishCounter.end(), TPopulationTable::Populations.begin(), 0ULL);
+}
+
+bool IsDefaultModel(const ReproductionModel& model)
+{
+    return model.Period == K_DAYS_PER_REPRODUCTION &&
+        model.NewbornDelay == K_NEW_FISH_EXTRA_DAYS &&
+        model.Days == K_NUMBER_OF_DAYS;
+}
+
+u64 ComputeTotalFishCount(const FishHistogram& histogram, const ReproductionModel& model)
+{
+    if (IsDefaultModel(model))
+    {
+        FishCounter fishCounter{};
+        std::copy(histogram.begin(), histogram.end(), fishCounter.begin());
+        return ComputeTotalFishCount<DefaultPopulationTable>(fishCounter);
     }
+
+    TransitionPowers powers{};
+    BuildTransitionPowers(powers, model, model.Days);
+
+    std::vector<u64> populations{};
+    ComputePopulationVector(populations, powers, model.Days);
+    return std::inner_product(histogram.begin(), histogram.end(), populations.begin(), 0ULL);
 }
 
-u64 ComputeTotalFishCount(const FishCounter& fishCounter)
+// Random populations of fish with timers below the period, evaluated at two horizons. A few of
+// them are also simulated day by day to check the batch results.
+void RunFishBatch(const ReproductionModel& model, size_t populationCount)
 {
-    return std::accumulate(fishCounter.begin(), fishCounter.end(), 0ULL);
+    std::mt19937 randomEngine{ K_BATCH_RANDOM_SEED };
+    std::uniform_int_distribution<u32> timerDistribution{ 0, model.Period - 1 };
+
+    size_t checkedPopulationCount{ std::min(populationCount, K_BATCH_CHECKED_POPULATION_COUNT) };
+    std::vector<FishHistogram> checkedHistograms{};
+    FishCounterBatch batch{};
+    InitializeBatch(batch, model);
+    for (size_t population = 0; population < populationCount; ++population)
+    {
+        FishHistogram histogram(model.Period + model.NewbornDelay, 0);
+        for (u32 fish = 0; fish < K_BATCH_FISH_PER_POPULATION; ++fish)
+        {
+            ++histogram[timerDistribution(randomEngine)];
+        }
+        AddToBatch(batch, histogram);
+
+        if (population < checkedPopulationCount)
+        {
+            checkedHistograms.push_back(histogram);
+        }
+    }
+
+    std::vector<u32> dayCounts{ K_BATCH_FIRST_HORIZON, model.Days };
+    std::vector<u64> fishCounts{};
+    auto startTime{ std::chrono::steady_clock::now() };
+    ComputeBatchFishCounts(batch, model, dayCounts, fishCounts);
+    std::chrono::duration<double> batchTime{ std::chrono::steady_clock::now() - startTime };
+
+    fmt::print("Evaluated {} populations at {} horizons in {:.3f} ms.\n", populationCount, dayCounts.size(), batchTime.count() * 1000.0);
+    for (size_t horizon = 0; horizon < dayCounts.size(); ++horizon)
+    {
+        const u64* horizonFishCounts{ fishCounts.data() + horizon * populationCount };
+        double totalFishCount{ std::accumulate(horizonFishCounts, horizonFishCounts + populationCount, 0.0) };
+        fmt::print("Mean fish count after {} days: {:.1f}.\n", dayCounts[horizon], totalFishCount / populationCount);
+    }
+
+    size_t mismatchCount{};
+    for (size_t horizon = 0; horizon < dayCounts.size(); ++horizon)
+    {
+        if (dayCounts[horizon] > K_MAX_CHECKED_DAYS)
+        {
+            continue;
+        }
+        for (size_t population = 0; population < checkedPopulationCount; ++population)
+        {
+            std::vector<u64> fishCounter{ checkedHistograms[population] };
+            SimulateForNDays(fishCounter, model.Period, dayCounts[horizon]);
+            u64 simulatedFishCount{ std::accumulate(fishCounter.begin(), fishCounter.end(), 0ULL) };
+            mismatchCount += simulatedFishCount != fishCounts[horizon * populationCount + population];
+        }
+    }
+    fmt::print("Checked {} populations against a day by day simulation: {} mismatches.\n", checkedPopulationCount, mismatchCount);
 }
 
-int main()
+// --batch <count> evaluates that many random populations instead of the input. The optional
+// reproduction model arguments follow it.
+int main(int argc, char** argv)
 {
-    FishCounter fishCounter{};
-    if (ReadInput(fishCounter))
+    bool isBatch{ argc > 1 && std::strcmp(argv[1], "--batch") == 0 };
+    u32 batchPopulationCount{};
+    if (isBatch)
     {
-        SimulateForNDays(fishCounter, K_NUMBER_OF_DAYS);
-        u64 totalFishCount{ ComputeTotalFishCount(fishCounter) };
+        if (argc <= 2 || !ReadArgumentValue(argv[2], batchPopulationCount) || batchPopulationCount == 0)
+        {
+            fmt::print("Usage: {} --batch <population count> [days] [period] [newborn delay].\n", argv[0]);
+            return -1;
+        }
+    }
+
+    ReproductionModel model{};
+    if (!ReadModel(model, argc, argv, isBatch ? 3 : 1))
+    {
+        fmt::print("Usage: {} [days] [period] [newborn delay], with period + newborn delay at most {}.\n", argv[0], K_MAX_TIMER_COUNT);
+        return -1;
+    }
+
+    if (isBatch)
+    {
+        RunFishBatch(model, batchPopulationCount);
+        return 0;
+    }
+
+    FishHistogram histogram{};
+    if (ReadInput(histogram))
+    {
+        if (histogram.size() > model.Period + model.NewbornDelay)
+        {
+            fmt::print("Input contains a timer beyond the reproduction model.\n");
+            return -1;
+        }
+
+        u64 totalFishCount{ ComputeTotalFishCount(histogram, model) };
 
         fmt::print("Total fish count: {}.\n", totalFishCount);
     }
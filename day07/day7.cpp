@@ -1,11 +1,177 @@
 ﻿#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <fstream>
 #include <numeric>
+#include <thread>
 #include <vector>
 
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
 #include <fmt/core.h>
 
 
 using i32 = std::int32_t;
+using u32 = std::uint32_t;
+using u64 = std::uint64_t;
+
+static constexpr size_t K_READ_BUFFER_SIZE{ 1 << 16 };
+static constexpr size_t K_MIN_CRABS_PER_THREAD{ 1 << 16 };
+static constexpr size_t K_BENCHMARK_CRAB_COUNT{ 100'000'000 };
+static constexpr u32 K_BENCHMARK_REPETITIONS{ 5 };
+
+// Prefix sums over a position histogram: entry p covers the crabs strictly below position p.
+struct CrabHistogram
+{
+    std::vector<u64> PositionCounts{};
+    std::vector<u64> PrefixCounts{};
+    std::vector<u64> PrefixPositions{};
+    u64 TotalSquaredPositions{};
+    i32 MaxPosition{};
+};
+
+struct FuelReport
+{
+    i32 Position{};
+    u64 Fuel{};
+};
+
+bool ReadInput(std::vector<i32>& crabPositions)
+{
+    static const char* inputFile{ "input.txt" };
+    std::ifstream inputStream{ inputFile, std::ios::binary };
+
+    bool readSucceeded{ inputStream.is_open() };
+    if (readSucceeded)
+    {
+        std::vector<char> buffer(K_READ_BUFFER_SIZE);
+        i32 position{};
+        bool hasDigits{};
+
+        while (inputStream)
+        {
+            inputStream.read(buffer.data(), buffer.size());
+            std::streamsize readSize{ inputStream.gcount() };
+            for (std::streamsize i = 0; i < readSize; ++i)
+            {
+                i32 digit{ buffer[i] - '0' };
+                if (digit >= 0 && digit < 10)
+                {
+                    position = position * 10 + digit;
+                    hasDigits = true;
+                }
+                else if (hasDigits)
+                {
+                    crabPositions.push_back(position);
+                    position = 0;
+                    hasDigits = false;
+                }
+            }
+        }
+
+        if (hasDigits)
+        {
+            crabPositions.push_back(position);
+        }
+
+        inputStream.close();
+    }
+
+    return readSucceeded;
+}
+
+void BuildCrabHistogram(CrabHistogram& histogram, const std::vector<i32>& crabPositions)
+{
+    histogram.MaxPosition = crabPositions.empty() ? 0 : *std::max_element(crabPositions.begin(), crabPositions.end());
+
+    histogram.PositionCounts.assign(histogram.MaxPosition + 1, 0);
+    for (i32 position : crabPositions)
+    {
+        ++histogram.PositionCounts[position];
+    }
+
+    histogram.PrefixCounts.assign(histogram.MaxPosition + 2, 0);
+    histogram.PrefixPositions.assign(histogram.MaxPosition + 2, 0);
+    histogram.TotalSquaredPositions = 0;
+    for (i32 position = 0; position <= histogram.MaxPosition; ++position)
+    {
+        u64 count{ histogram.PositionCounts[position] };
+        histogram.PrefixCounts[position + 1] = histogram.PrefixCounts[position] + count;
+        histogram.PrefixPositions[position + 1] = histogram.PrefixPositions[position] + count * position;
+        histogram.TotalSquaredPositions += count * position * position;
+    }
+}
+
+u64 ComputeLinearFuel(const CrabHistogram& histogram, i32 destinationPosition)
+{
+    u64 target{ (u64)destinationPosition };
+    u64 countBelow{ histogram.PrefixCounts[destinationPosition] };
+    u64 positionsBelow{ histogram.PrefixPositions[destinationPosition] };
+    u64 countAbove{ histogram.PrefixCounts.back() - countBelow };
+    u64 positionsAbove{ histogram.PrefixPositions.back() - positionsBelow };
+    return (target * countBelow - positionsBelow) + (positionsAbove - target * countAbove);
+}
+
+// Moving d steps costs d * (d + 1) / 2, so the total is (sum(d^2) + sum(d)) / 2,
+// and sum(d^2) expands to sum(p^2) - 2 * t * sum(p) + t^2 * n.
+u64 ComputeTriangularFuel(const CrabHistogram& histogram, i32 destinationPosition)
+{
+    u64 target{ (u64)destinationPosition };
+    u64 squaredDistances{ histogram.TotalSquaredPositions + target * target * histogram.PrefixCounts.back() - 2 * target * histogram.PrefixPositions.back() };
+    return (squaredDistances + ComputeLinearFuel(histogram, destinationPosition)) / 2;
+}
+
+struct LinearFuelCost
+{
+    u64 operator()(u64 distance) const { return distance; }
+};
+
+struct TriangularFuelCost
+{
+    u64 operator()(u64 distance) const { return distance * (distance + 1) / 2; }
+};
+
+template <typename TFuelCost>
+u64 ComputeTotalFuel(const CrabHistogram& histogram, i32 destinationPosition, const TFuelCost& fuelCost)
+{
+    u64 totalFuel{};
+    for (i32 position = 0; position <= histogram.MaxPosition; ++position)
+    {
+        u64 distance{ (u64)std::abs(destinationPosition - position) };
+        totalFuel += histogram.PositionCounts[position] * fuelCost(distance);
+    }
+    return totalFuel;
+}
+
+// The total fuel is convex in the destination as long as the per-distance cost is convex
+// and non-decreasing, so the leftmost minimum is where the discrete derivative stops being negative.
+template <typename TTotalFuelFunction>
+FuelReport FindConvexMinimum(i32 minPosition, i32 maxPosition, TTotalFuelFunction computeTotalFuel)
+{
+    while (minPosition < maxPosition)
+    {
+        i32 midPosition{ minPosition + (maxPosition - minPosition) / 2 };
+        if (computeTotalFuel(midPosition) <= computeTotalFuel(midPosition + 1))
+        {
+            maxPosition = midPosition;
+        }
+        else
+        {
+            minPosition = midPosition + 1;
+        }
+    }
+
+    return { minPosition, computeTotalFuel(minPosition) };
+}
+
+template <typename TFuelCost>
+FuelReport FindCheapestPosition(const CrabHistogram& histogram, const TFuelCost& fuelCost)
+{
+    auto computeTotalFuel = [&histogram, &fuelCost](i32 position) { return ComputeTotalFuel(histogram, position, fuelCost); };
+    return FindConvexMinimum(0, histogram.MaxPosition, computeTotalFuel);
+}
 
 i32 ComputeMedianPosition(const std::vector<i32>& crabPositions)
 {
@@ -15,48 +181,214 @@ i32 ComputeMedianPosition(const std::vector<i32>& crabPositions)
     return crabPositionsCopy[n];
 }
 
-i32 ComputeMeanPosition(const std::vector<i32>& crabPositions)
+u64 ComputeFuelKernelLinear(const i32* crabPositions, size_t crabCount, i32 destinationPosition)
 {
-    return std::accumulate(crabPositions.begin(), crabPositions.end(), 0) / crabPositions.size();
+    size_t crab{};
+    u64 totalFuel{};
+
+#if defined(__AVX2__)
+    __m256i destination{ _mm256_set1_epi32(destinationPosition) };
+    __m256i fuelSums{ _mm256_setzero_si256() };
+    for (; crab + 8 <= crabCount; crab += 8)
+    {
+        __m256i positions{ _mm256_loadu_si256(reinterpret_cast<const __m256i*>(crabPositions + crab)) };
+        __m256i distances{ _mm256_abs_epi32(_mm256_sub_epi32(positions, destination)) };
+        fuelSums = _mm256_add_epi64(fuelSums, _mm256_cvtepu32_epi64(_mm256_castsi256_si128(distances)));
+        fuelSums = _mm256_add_epi64(fuelSums, _mm256_cvtepu32_epi64(_mm256_extracti128_si256(distances, 1)));
+    }
+
+    alignas(32) u64 laneSums[4]{};
+    _mm256_store_si256(reinterpret_cast<__m256i*>(laneSums), fuelSums);
+    totalFuel = laneSums[0] + laneSums[1] + laneSums[2] + laneSums[3];
+#endif
+
+    for (; crab < crabCount; ++crab)
+    {
+        totalFuel += (u64)std::abs(destinationPosition - crabPositions[crab]);
+    }
+
+    return totalFuel;
 }
 
-i32 ComputeTotalNeededFuelLinear(const std::vector<i32>& crabPositions, i32 destinationPosition)
+u64 ComputeFuelKernelTriangular(const i32* crabPositions, size_t crabCount, i32 destinationPosition)
 {
-    auto addDistance = [destinationPosition](i32 subTotal, i32 position) { return subTotal + std::abs(destinationPosition - position); };
-    return std::accumulate(crabPositions.begin(), crabPositions.end(), 0U, addDistance);
+    size_t crab{};
+    u64 totalFuel{};
+
+#if defined(__AVX2__)
+    __m256i destination{ _mm256_set1_epi32(destinationPosition) };
+    __m256i ones{ _mm256_set1_epi64x(1) };
+    __m256i fuelSums{ _mm256_setzero_si256() };
+
+    // The products are computed in 64 bit lanes, so d * (d + 1) cannot overflow.
+    auto addTriangularFuel = [&fuelSums, &ones](__m128i distances)
+    {
+        __m256i wideDistances{ _mm256_cvtepu32_epi64(distances) };
+        __m256i products{ _mm256_mul_epu32(wideDistances, _mm256_add_epi64(wideDistances, ones)) };
+        fuelSums = _mm256_add_epi64(fuelSums, _mm256_srli_epi64(products, 1));
+    };
+
+    for (; crab + 8 <= crabCount; crab += 8)
+    {
+        __m256i positions{ _mm256_loadu_si256(reinterpret_cast<const __m256i*>(crabPositions + crab)) };
+        __m256i distances{ _mm256_abs_epi32(_mm256_sub_epi32(positions, destination)) };
+        addTriangularFuel(_mm256_castsi256_si128(distances));
+        addTriangularFuel(_mm256_extracti128_si256(distances, 1));
+    }
+
+    alignas(32) u64 laneSums[4]{};
+    _mm256_store_si256(reinterpret_cast<__m256i*>(laneSums), fuelSums);
+    totalFuel = laneSums[0] + laneSums[1] + laneSums[2] + laneSums[3];
+#endif
+
+    for (; crab < crabCount; ++crab)
+    {
+        u64 distanceTraveled{ (u64)std::abs(destinationPosition - crabPositions[crab]) };
+        totalFuel += distanceTraveled * (distanceTraveled + 1) / 2;
+    }
+
+    return totalFuel;
 }
 
-i32 ComputeTotalNeededFuelExponential(const std::vector<i32>& crabPositions, i32 destinationPosition)
+template <typename TFuelKernel>
+u64 ComputeFuelParallel(const std::vector<i32>& crabPositions, i32 destinationPosition, TFuelKernel fuelKernel, u32 threadCount)
 {
-    auto addDistance = [destinationPosition](i32 subTotal, i32 position)
+    size_t crabCount{ crabPositions.size() };
+    threadCount = (u32)std::max<size_t>(1, std::min<size_t>(threadCount, crabCount / K_MIN_CRABS_PER_THREAD));
+    size_t crabsPerThread{ (crabCount + threadCount - 1) / threadCount };
+
+    std::vector<u64> partialFuels(threadCount, 0);
+    std::vector<std::thread> workers{};
+    for (u32 threadIndex = 1; threadIndex < threadCount; ++threadIndex)
     {
-        i32 distanceTraveled{ std::abs(destinationPosition - position) };
-        i32 fuelNeeded{ distanceTraveled % 2 == 0 ? (distanceTraveled / 2) * (distanceTraveled + 1) : (distanceTraveled / 2 + 1) * distanceTraveled };
-        return subTotal + fuelNeeded;
-    };
-    return std::accumulate(crabPositions.begin(), crabPositions.end(), 0U, addDistance);
+        size_t firstCrab{ std::min(crabCount, threadIndex * crabsPerThread) };
+        size_t lastCrab{ std::min(crabCount, firstCrab + crabsPerThread) };
+        workers.emplace_back([&, firstCrab, lastCrab, threadIndex]()
+            {
+                partialFuels[threadIndex] = fuelKernel(crabPositions.data() + firstCrab, lastCrab - firstCrab, destinationPosition);
+            });
+    }
+
+    partialFuels[0] = fuelKernel(crabPositions.data(), std::min(crabCount, crabsPerThread), destinationPosition);
+
+    for (std::thread& worker : workers)
+    {
+        worker.join();
+    }
+
+    return std::accumulate(partialFuels.begin(), partialFuels.end(), 0ULL);
+}
+
+u32 GetWorkerThreadCount()
+{
+    return std::max(1U, std::thread::hardware_concurrency());
+}
+
+u64 ComputeTotalNeededFuelLinear(const std::vector<i32>& crabPositions, i32 destinationPosition)
+{
+    return ComputeFuelParallel(crabPositions, destinationPosition, ComputeFuelKernelLinear, GetWorkerThreadCount());
 }
 
-int main()
+u64 ComputeTotalNeededFuelExponential(const std::vector<i32>& crabPositions, i32 destinationPosition)
 {
-    // Saw this trick in someone's solution for another day of AoC.
-    // It's ugly, but I found it amusing.
-    std::vector<i32> crabPositions
+    return ComputeFuelParallel(crabPositions, destinationPosition, ComputeFuelKernelTriangular, GetWorkerThreadCount());
+}
+
+template <typename TFuelKernel>
+void BenchmarkFuelKernel(const char* kernelName, const std::vector<i32>& crabPositions, i32 destinationPosition, TFuelKernel fuelKernel, u32 threadCount)
+{
+    u64 totalFuel{};
+    auto startTime{ std::chrono::steady_clock::now() };
+    for (u32 i = 0; i < K_BENCHMARK_REPETITIONS; ++i)
     {
-#include "input.txt"
-    };
+        totalFuel += ComputeFuelParallel(crabPositions, destinationPosition, fuelKernel, threadCount);
+    }
+    std::chrono::duration<double> elapsedTime{ std::chrono::steady_clock::now() - startTime };
+
+    double crabsPerSecond{ (double)crabPositions.size() * K_BENCHMARK_REPETITIONS / elapsedTime.count() };
+    fmt::print("{} ({} threads): {:.3e} crabs/s (checksum {}).\n", kernelName, threadCount, crabsPerSecond, totalFuel);
+}
 
-    i32 destinationMedianPosition{ ComputeMedianPosition(crabPositions) };
-    i32 neededFuelMedian{ ComputeTotalNeededFuelLinear(crabPositions, destinationMedianPosition) };
+void RunFuelBenchmark(const std::vector<i32>& crabPositions)
+{
+    std::vector<i32> benchmarkPositions(K_BENCHMARK_CRAB_COUNT);
+    for (size_t crab = 0; crab < K_BENCHMARK_CRAB_COUNT; ++crab)
+    {
+        benchmarkPositions[crab] = crabPositions[crab % crabPositions.size()];
+    }
 
-    fmt::print("Destination Position (using median): {}.\n", destinationMedianPosition);
-    fmt::print("Needed Fuel: {}.\n", neededFuelMedian);
+    i32 destinationPosition{ ComputeMedianPosition(crabPositions) };
+    fmt::print("Benchmarking {} crabs, {} repetitions.\n", K_BENCHMARK_CRAB_COUNT, K_BENCHMARK_REPETITIONS);
 
-    i32 destinationMeanPosition{ ComputeMeanPosition(crabPositions) };
-    i32 neededFuelMean{ ComputeTotalNeededFuelExponential(crabPositions, destinationMeanPosition) };
+    for (u32 threadCount : { 1U, GetWorkerThreadCount() })
+    {
+        BenchmarkFuelKernel("Linear", benchmarkPositions, destinationPosition, ComputeFuelKernelLinear, threadCount);
+        BenchmarkFuelKernel("Triangular", benchmarkPositions, destinationPosition, ComputeFuelKernelTriangular, threadCount);
+    }
+}
 
-    fmt::print("Destination Position (using mean): {}.\n", destinationMeanPosition);
-    fmt::print("Needed Fuel: {}.\n", neededFuelMean);
+// Solves again with the generic optimizer, which evaluates the per-distance cost functors on the
+// whole histogram for every probed position, and recomputes the fuel at the chosen positions from
+// the raw crab positions with the parallel kernels. Both must match the prefix sum answers.
+bool VerifyFuelReports(const std::vector<i32>& crabPositions, const CrabHistogram& histogram, const FuelReport& linearReport, const FuelReport& triangularReport)
+{
+    FuelReport genericLinearReport{ FindCheapestPosition(histogram, LinearFuelCost{}) };
+    FuelReport genericTriangularReport{ FindCheapestPosition(histogram, TriangularFuelCost{}) };
+    u64 kernelLinearFuel{ ComputeTotalNeededFuelLinear(crabPositions, linearReport.Position) };
+    u64 kernelTriangularFuel{ ComputeTotalNeededFuelExponential(crabPositions, triangularReport.Position) };
+
+    bool isLinearMatching{ genericLinearReport.Position == linearReport.Position && genericLinearReport.Fuel == linearReport.Fuel };
+    bool isTriangularMatching{ genericTriangularReport.Position == triangularReport.Position && genericTriangularReport.Fuel == triangularReport.Fuel };
+    bool isLinearKernelMatching{ kernelLinearFuel == linearReport.Fuel };
+    bool isTriangularKernelMatching{ kernelTriangularFuel == triangularReport.Fuel };
+    fmt::print("Generic optimizer (linear fuel): {} at {}, {}.\n", genericLinearReport.Fuel, genericLinearReport.Position, isLinearMatching ? "matching" : "MISMATCH");
+    fmt::print("Generic optimizer (triangular fuel): {} at {}, {}.\n", genericTriangularReport.Fuel, genericTriangularReport.Position, isTriangularMatching ? "matching" : "MISMATCH");
+    fmt::print("Fuel kernels (linear fuel): {}, {}.\n", kernelLinearFuel, isLinearKernelMatching ? "matching" : "MISMATCH");
+    fmt::print("Fuel kernels (triangular fuel): {}, {}.\n", kernelTriangularFuel, isTriangularKernelMatching ? "matching" : "MISMATCH");
+    return isLinearMatching && isTriangularMatching && isLinearKernelMatching && isTriangularKernelMatching;
+}
+
+// --benchmark times the fuel kernels on a large replicated input, and --verify checks the answers
+// against the generic optimizer.
+int main(int argc, char** argv)
+{
+    std::vector<i32> crabPositions{};
+    if (ReadInput(crabPositions))
+    {
+        if (crabPositions.empty())
+        {
+            fmt::print("No crab positions in input file.\n");
+            return -1;
+        }
+
+        if (argc > 1 && std::strcmp(argv[1], "--benchmark") == 0)
+        {
+            RunFuelBenchmark(crabPositions);
+            return 0;
+        }
+
+        CrabHistogram histogram{};
+        BuildCrabHistogram(histogram, crabPositions);
+
+        auto computeLinearFuel = [&histogram](i32 position) { return ComputeLinearFuel(histogram, position); };
+        FuelReport linearReport{ FindConvexMinimum(0, histogram.MaxPosition, computeLinearFuel) };
+        fmt::print("Destination Position (linear fuel): {}.\n", linearReport.Position);
+        fmt::print("Needed Fuel: {}.\n", linearReport.Fuel);
+
+        auto computeTriangularFuel = [&histogram](i32 position) { return ComputeTriangularFuel(histogram, position); };
+        FuelReport triangularReport{ FindConvexMinimum(0, histogram.MaxPosition, computeTriangularFuel) };
+        fmt::print("Destination Position (triangular fuel): {}.\n", triangularReport.Position);
+        fmt::print("Needed Fuel: {}.\n", triangularReport.Fuel);
+
+        if (argc > 1 && std::strcmp(argv[1], "--verify") == 0)
+        {
+            return VerifyFuelReports(crabPositions, histogram, linearReport, triangularReport) ? 0 : -1;
+        }
+    }
+    else
+    {
+        fmt::print("Failed to open input file.\n");
+    }
 
     return 0;
-}
\ No newline at end of file
+}
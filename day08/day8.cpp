@@ -1,20 +1,39 @@
 ﻿#include <algorithm>
-#include <fstream>
-#include <numeric>
-#include <sstream>
-#include <string>
+#include <array>
+#include <thread>
 #include <vector>
 
 #include <fmt/core.h>
 
+#include "mappedfile.h"
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
 
 using u8 = std::uint8_t;
 using u32 = std::uint32_t;
+using u64 = std::uint64_t;
 
 static constexpr u32 K_INPUT_COUNT = 10;
 static constexpr u32 K_OUTPUT_COUNT = 4;
 static constexpr u32 K_DISPLAY_SEGMENT_COUNT = 7;
-static constexpr u8 SEGMENT_MASK{ (1 << K_DISPLAY_SEGMENT_COUNT) - 1 };
+static constexpr u32 K_DIGIT_COUNT = 10;
+static constexpr u32 K_MAX_SIGNATURE{ K_INPUT_COUNT * K_DISPLAY_SEGMENT_COUNT };
+static constexpr u32 K_SIGNATURE_NIBBLE_COUNT{ K_MAX_SIGNATURE / 16 + 1 };
+static constexpr size_t K_BATCH_LINE_COUNT{ 32 };
+static constexpr u32 K_PATTERN_SLOT_COUNT{ K_INPUT_COUNT + K_OUTPUT_COUNT };
+static constexpr size_t K_PIPELINE_BLOCK_SIZE{ 1 << 16 };
+
+// Segments of the unscrambled digits, with segment 'a' in bit 0.
+static constexpr std::array<u8, K_DIGIT_COUNT> K_DIGIT_SEGMENTS
+{
+    0b1110111, 0b0100100, 0b1011101, 0b1101101, 0b0101110,
+    0b1101011, 0b1111011, 0b0100101, 0b1111111, 0b1101111,
+};
 
 struct NotesLine
 {
@@ -22,73 +41,256 @@ struct NotesLine
     u8 Outputs[K_OUTPUT_COUNT];
 };
 
-using Notes = std::vector<NotesLine>;
+// Struct-of-arrays layout: Inputs[i][line] is the i-th input pattern of a line.
+struct Notes
+{
+    std::array<std::vector<u8>, K_INPUT_COUNT> Inputs{};
+    std::array<std::vector<u8>, K_OUTPUT_COUNT> Outputs{};
+    size_t LineCount{};
+};
+
+void ResizeNotes(Notes& notes, size_t lineCount)
+{
+    for (std::vector<u8>& inputs : notes.Inputs)
+    {
+        inputs.resize(lineCount);
+    }
+    for (std::vector<u8>& outputs : notes.Outputs)
+    {
+        outputs.resize(lineCount);
+    }
+    notes.LineCount = lineCount;
+}
 
-u8 ReadDigit(const std::string& digitText)
+void GetNotesLine(const Notes& notes, size_t lineIndex, NotesLine& line)
 {
-    u8 digitValue{};
-    for (char c : digitText)
+    for (u32 i = 0; i < K_INPUT_COUNT; ++i)
+    {
+        line.Inputs[i] = notes.Inputs[i][lineIndex];
+    }
+    for (u32 i = 0; i < K_OUTPUT_COUNT; ++i)
     {
-        u32 bitShiftAmount{ (u32)(c - 'a') };
-        FMT_ASSERT(bitShiftAmount < K_DISPLAY_SEGMENT_COUNT, "Should not occur.");
-        digitValue |= (1 << bitShiftAmount);
+        line.Outputs[i] = notes.Outputs[i][lineIndex];
     }
+}
 
-    return digitValue;
+inline u32 CountSetBits(u32 bits)
+{
+#if defined(_MSC_VER)
+    return __popcnt(bits);
+#else
+    return __builtin_popcount(bits);
+#endif
 }
 
-void ReadNoteLine(NotesLine& notesLine, const std::string& lineText)
+inline u32 CountSetBits64(u64 bits)
 {
-    std::string currentDigitText{};
-    std::stringstream ss{ lineText };
+#if defined(_MSC_VER)
+    return (u32)__popcnt64(bits);
+#else
+    return (u32)__builtin_popcountll(bits);
+#endif
+}
 
-    for (u32 i = 0; i < K_INPUT_COUNT; ++i)
+inline u32 CountTrailingZeros64(u64 bits)
+{
+#if defined(_MSC_VER)
+    unsigned long index{};
+    _BitScanForward64(&index, bits);
+    return (u32)index;
+#else
+    return (u32)__builtin_ctzll(bits);
+#endif
+}
+
+// Segment bit of each letter 'a' to 'g', 0 for every other byte.
+constexpr std::array<u8, 256> BuildSegmentTable()
+{
+    std::array<u8, 256> segmentBits{};
+    for (u32 segment = 0; segment < K_DISPLAY_SEGMENT_COUNT; ++segment)
     {
-        ss >> currentDigitText;
-        notesLine.Inputs[i] = ReadDigit(currentDigitText);
+        segmentBits['a' + segment] = (u8)(1 << segment);
     }
+    return segmentBits;
+}
 
-    ss >> currentDigitText; // To ignore '|'
+static constexpr std::array<u8, 256> K_SEGMENT_BITS{ BuildSegmentTable() };
 
-    for (u32 i = 0; i < K_OUTPUT_COUNT; ++i)
+#if defined(__AVX2__)
+inline u64 ComputeByteMask64(const char* data, char searchedByte)
+{
+    __m256i searched{ _mm256_set1_epi8(searchedByte) };
+    __m256i low{ _mm256_cmpeq_epi8(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(data)), searched) };
+    __m256i high{ _mm256_cmpeq_epi8(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + 32)), searched) };
+    return (u64)(u32)_mm256_movemask_epi8(low) | ((u64)(u32)_mm256_movemask_epi8(high) << 32);
+}
+
+// Letters 'a' to 'g' are exactly the bytes 0x61 to 0x67.
+inline u64 ComputeLetterMask64(const char* data)
+{
+    const __m256i highBitsMask{ _mm256_set1_epi8((char)0xF8) };
+    const __m256i letterHighBits{ _mm256_set1_epi8(0x60) };
+    auto computeLetterMask32 = [&](const char* block)
+    {
+        __m256i bytes{ _mm256_loadu_si256(reinterpret_cast<const __m256i*>(block)) };
+        __m256i isInRange{ _mm256_cmpeq_epi8(_mm256_and_si256(bytes, highBitsMask), letterHighBits) };
+        __m256i isBacktick{ _mm256_cmpeq_epi8(bytes, letterHighBits) };
+        return (u32)_mm256_movemask_epi8(_mm256_andnot_si256(isBacktick, isInRange));
+    };
+    return (u64)computeLetterMask32(data) | ((u64)computeLetterMask32(data + 32) << 32);
+}
+
+// Reads the pattern starting at data, which ends at the first byte that is not a letter.
+// Letters of a pattern are all distinct, so summing their segment bits is the same as or-ing them.
+inline u8 ReadPatternSIMD(const char* data)
+{
+    const __m128i segmentBitTable{ _mm_setr_epi8(0, 1, 2, 4, 8, 16, 32, 64, 0, 0, 0, 0, 0, 0, 0, 0) };
+    const __m128i byteIndices{ _mm_setr_epi8(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15) };
+    __m128i bytes{ _mm_loadu_si128(reinterpret_cast<const __m128i*>(data)) };
+    __m128i isLetter{ _mm_andnot_si128(_mm_cmpeq_epi8(bytes, _mm_set1_epi8(0x60)),
+                                       _mm_cmpeq_epi8(_mm_and_si128(bytes, _mm_set1_epi8((char)0xF8)), _mm_set1_epi8(0x60))) };
+    u32 patternLength{ CountTrailingZeros64(~(u64)(u32)_mm_movemask_epi8(isLetter)) };
+    __m128i isInPattern{ _mm_cmpgt_epi8(_mm_set1_epi8((char)patternLength), byteIndices) };
+    __m128i segmentBits{ _mm_shuffle_epi8(segmentBitTable, _mm_and_si128(bytes, _mm_set1_epi8(0x07))) };
+    return (u8)_mm_cvtsi128_si32(_mm_sad_epu8(_mm_and_si128(segmentBits, isInPattern), _mm_setzero_si128()));
+}
+#endif
+
+inline u64 ComputeLetterMaskScalar(const char* data, size_t size)
+{
+    u64 mask{};
+    for (size_t i = 0; i < size; ++i)
     {
-        ss >> currentDigitText;
-        notesLine.Outputs[i] = ReadDigit(currentDigitText);
+        mask |= (u64)(K_SEGMENT_BITS[(u8)data[i]] != 0) << i;
     }
+    return mask;
 }
 
-bool ReadInput(Notes& notes)
+inline u64 ComputeByteMaskScalar(const char* data, size_t size, char searchedByte)
 {
-    static const char* inputFile{ "input.txt" };
-    std::ifstream inputStream{ inputFile };
+    u64 mask{};
+    for (size_t i = 0; i < size; ++i)
+    {
+        mask |= (u64)(data[i] == searchedByte) << i;
+    }
+    return mask;
+}
 
-    bool readSucceeded{ inputStream.is_open() };
-    if (readSucceeded)
+inline u8 ReadPatternScalar(const char* data, const char* dataEnd)
+{
+    u8 pattern{};
+    for (; data != dataEnd && K_SEGMENT_BITS[(u8)*data] != 0; ++data)
     {
-        std::string lineText;
-        while (std::getline(inputStream, lineText))
-        {
-            NotesLine& notesLine{ notes.emplace_back() };
-            ReadNoteLine(notesLine, lineText);
-        }
+        pattern |= K_SEGMENT_BITS[(u8)*data];
+    }
+    return pattern;
+}
+
+size_t CountNoteLines(const char* data, size_t size)
+{
+    size_t lineCount{};
+    size_t offset{};
 
-        inputStream.close();
+#if defined(__AVX2__)
+    for (; offset + 64 <= size; offset += 64)
+    {
+        lineCount += CountSetBits64(ComputeByteMask64(data + offset, '\n'));
     }
+#endif
+    lineCount += (size_t)std::count(data + offset, data + size, '\n');
 
-    return readSucceeded;
+    if (size > 0 && data[size - 1] != '\n')
+    {
+        ++lineCount;
+    }
+    return lineCount;
 }
 
-u32 CountActiveSegmentCount(u8 digit)
+// Single pass over the raw text, 64 bytes at a time: the letter bitmask of each block gives the
+// start of every pattern, which lands in its slot by position, so the '|' separator needs no
+// handling. Line breaks only check that each line held exactly K_PATTERN_SLOT_COUNT patterns;
+// otherwise errorOffset is set to where the malformed line was detected.
+bool ParseNotes(Notes& notes, size_t firstLine, const char* data, size_t size, size_t& parsedLineCount, size_t& errorOffset)
 {
-    u32 segmentCount{};
-    for (u32 i = 0; i < K_DISPLAY_SEGMENT_COUNT; ++i)
+    u8* slots[K_PATTERN_SLOT_COUNT]{};
+    for (u32 i = 0; i < K_INPUT_COUNT; ++i)
+    {
+        slots[i] = notes.Inputs[i].data() + firstLine;
+    }
+    for (u32 i = 0; i < K_OUTPUT_COUNT; ++i)
+    {
+        slots[K_INPUT_COUNT + i] = notes.Outputs[i].data() + firstLine;
+    }
+
+    size_t lineOffset{};
+    u32 slot{};
+    u64 previousLetterBit{};
+    const char* dataEnd{ data + size };
+
+    for (size_t blockStart = 0; blockStart < size; blockStart += 64)
     {
-        if (digit & (1 << i))
+        size_t blockSize{ std::min<size_t>(64, size - blockStart) };
+#if defined(__AVX2__)
+        u64 letters{ blockSize == 64 ? ComputeLetterMask64(data + blockStart) : ComputeLetterMaskScalar(data + blockStart, blockSize) };
+        u64 lineBreaks{ blockSize == 64 ? ComputeByteMask64(data + blockStart, '\n') : ComputeByteMaskScalar(data + blockStart, blockSize, '\n') };
+#else
+        u64 letters{ ComputeLetterMaskScalar(data + blockStart, blockSize) };
+        u64 lineBreaks{ ComputeByteMaskScalar(data + blockStart, blockSize, '\n') };
+#endif
+        u64 patternStarts{ letters & ~((letters << 1) | previousLetterBit) };
+        previousLetterBit = letters >> 63;
+
+        for (u64 events{ patternStarts | lineBreaks }; events != 0; events &= events - 1)
         {
-            ++segmentCount;
+            u32 eventIndex{ CountTrailingZeros64(events) };
+            if ((lineBreaks >> eventIndex) & 1)
+            {
+                if (slot == K_PATTERN_SLOT_COUNT)
+                {
+                    slot = 0;
+                    ++lineOffset;
+                }
+                else if (slot != 0)
+                {
+                    errorOffset = blockStart + eventIndex;
+                    return false;
+                }
+                continue;
+            }
+
+            if (slot == K_PATTERN_SLOT_COUNT)
+            {
+                errorOffset = blockStart + eventIndex;
+                return false;
+            }
+
+            const char* patternText{ data + blockStart + eventIndex };
+#if defined(__AVX2__)
+            u8 pattern{ (dataEnd - patternText >= 16) ? ReadPatternSIMD(patternText) : ReadPatternScalar(patternText, dataEnd) };
+#else
+            u8 pattern{ ReadPatternScalar(patternText, dataEnd) };
+#endif
+            slots[slot++][lineOffset] = pattern;
         }
     }
-    return segmentCount;
+
+    if (slot == K_PATTERN_SLOT_COUNT)
+    {
+        ++lineOffset;
+    }
+    else if (slot != 0)
+    {
+        errorOffset = size;
+        return false;
+    }
+
+    parsedLineCount = lineOffset;
+    return true;
+}
+
+inline u32 CountActiveSegmentCount(u8 digit)
+{
+    return CountSetBits(digit);
 }
 
 bool IsSpecialSegmentCount(u32 segmentcount)
@@ -99,16 +301,141 @@ bool IsSpecialSegmentCount(u32 segmentcount)
         segmentcount == 7;
 }
 
-u32 CountOutputSpecialDigits(const Notes& notes)
+// A digit's signature is the number of segments it shares with each of the ten input patterns,
+// i.e. the sum of the frequencies of its segments. Those sums do not depend on the wiring and
+// differ for every digit, so they identify the digit without decoding the wiring at all.
+constexpr u32 ComputeSignature(u8 digit, const u8* patterns, u32 (*countSegments)(u8))
+{
+    u32 signature{};
+    for (u32 i = 0; i < K_INPUT_COUNT; ++i)
+    {
+        signature += countSegments(digit & patterns[i]);
+    }
+    return signature;
+}
+
+constexpr u32 CountActiveSegmentCountConstexpr(u8 digit)
 {
-    u32 specialDigitCount{};
+    u32 segmentCount{};
+    for (; digit != 0; digit &= digit - 1)
+    {
+        ++segmentCount;
+    }
+    return segmentCount;
+}
 
-    for (const NotesLine& line : notes)
+constexpr std::array<u8, K_MAX_SIGNATURE + 1> BuildSignatureTable()
+{
+    std::array<u8, K_MAX_SIGNATURE + 1> signatureToDigit{};
+    for (u8 digit = 0; digit < K_DIGIT_COUNT; ++digit)
     {
-        for (u8 digit : line.Outputs)
+        u32 signature{ ComputeSignature(K_DIGIT_SEGMENTS[digit], K_DIGIT_SEGMENTS.data(), CountActiveSegmentCountConstexpr) };
+        signatureToDigit[signature] = digit;
+    }
+    return signatureToDigit;
+}
+
+static constexpr std::array<u8, K_MAX_SIGNATURE + 1> K_SIGNATURE_TO_DIGIT{ BuildSignatureTable() };
+
+u32 ComputeOutputValue(const NotesLine& line)
+{
+    u32 outputValue{};
+    for (u8 digit : line.Outputs)
+    {
+        u32 signature{ ComputeSignature(digit, line.Inputs, CountActiveSegmentCount) };
+        outputValue = (outputValue * 10) + (u32)K_SIGNATURE_TO_DIGIT[signature];
+    }
+    return outputValue;
+}
+
+// Signature lookup split by nibbles so that it maps onto 16-entry byte shuffles:
+// digit = K_SIGNATURE_NIBBLE_TABLES[signature >> 4][signature & 0xF].
+constexpr std::array<std::array<u8, 16>, K_SIGNATURE_NIBBLE_COUNT> BuildSignatureNibbleTables()
+{
+    std::array<std::array<u8, 16>, K_SIGNATURE_NIBBLE_COUNT> nibbleTables{};
+    for (u32 signature = 0; signature <= K_MAX_SIGNATURE; ++signature)
+    {
+        nibbleTables[signature >> 4][signature & 0xF] = K_SIGNATURE_TO_DIGIT[signature];
+    }
+    return nibbleTables;
+}
+
+static constexpr std::array<std::array<u8, 16>, K_SIGNATURE_NIBBLE_COUNT> K_SIGNATURE_NIBBLE_TABLES{ BuildSignatureNibbleTables() };
+
+#if defined(__AVX2__)
+inline __m256i CountActiveSegmentsBatch(__m256i digits)
+{
+    const __m256i bitCountTable{ _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+                                                  0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4) };
+    const __m256i lowNibbleMask{ _mm256_set1_epi8(0x0F) };
+    __m256i lowCounts{ _mm256_shuffle_epi8(bitCountTable, _mm256_and_si256(digits, lowNibbleMask)) };
+    __m256i highCounts{ _mm256_shuffle_epi8(bitCountTable, _mm256_and_si256(_mm256_srli_epi16(digits, 4), lowNibbleMask)) };
+    return _mm256_add_epi8(lowCounts, highCounts);
+}
+
+inline __m256i LookupSignaturesBatch(__m256i signatures)
+{
+    const __m256i lowNibbleMask{ _mm256_set1_epi8(0x0F) };
+    __m256i lowNibbles{ _mm256_and_si256(signatures, lowNibbleMask) };
+    __m256i highNibbles{ _mm256_and_si256(_mm256_srli_epi16(signatures, 4), lowNibbleMask) };
+
+    __m256i digits{ _mm256_setzero_si256() };
+    for (u32 nibble = 0; nibble < K_SIGNATURE_NIBBLE_COUNT; ++nibble)
+    {
+        __m256i table{ _mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(K_SIGNATURE_NIBBLE_TABLES[nibble].data()))) };
+        __m256i isInTable{ _mm256_cmpeq_epi8(highNibbles, _mm256_set1_epi8((char)nibble)) };
+        digits = _mm256_or_si256(digits, _mm256_and_si256(isInTable, _mm256_shuffle_epi8(table, lowNibbles)));
+    }
+    return digits;
+}
+
+// Sums ((d0 * 10 + d1) * 10 + d2) * 10 + d3 over 16 lines, using 16 bit lanes for the values.
+inline __m256i SumOutputValuesBatch(const __m128i digits[K_OUTPUT_COUNT])
+{
+    __m256i values{ _mm256_cvtepu8_epi16(digits[0]) };
+    for (u32 i = 1; i < K_OUTPUT_COUNT; ++i)
+    {
+        values = _mm256_add_epi16(_mm256_mullo_epi16(values, _mm256_set1_epi16(10)), _mm256_cvtepu8_epi16(digits[i]));
+    }
+
+    __m256i pairSums{ _mm256_madd_epi16(values, _mm256_set1_epi16(1)) };
+    return _mm256_add_epi64(_mm256_cvtepu32_epi64(_mm256_castsi256_si128(pairSums)),
+                            _mm256_cvtepu32_epi64(_mm256_extracti128_si256(pairSums, 1)));
+}
+
+inline u64 SumLanes(__m256i values)
+{
+    alignas(32) u64 lanes[4]{};
+    _mm256_store_si256(reinterpret_cast<__m256i*>(lanes), values);
+    return lanes[0] + lanes[1] + lanes[2] + lanes[3];
+}
+#endif
+
+u64 CountOutputSpecialDigits(const Notes& notes, size_t firstLine, size_t lastLine)
+{
+    u64 specialDigitCount{};
+    size_t lineIndex{ firstLine };
+
+#if defined(__AVX2__)
+    for (; lineIndex + K_BATCH_LINE_COUNT <= lastLine; lineIndex += K_BATCH_LINE_COUNT)
+    {
+        for (u32 i = 0; i < K_OUTPUT_COUNT; ++i)
         {
-            u32 segmentCount{ CountActiveSegmentCount(digit) };
-            if (IsSpecialSegmentCount(segmentCount))
+            __m256i digits{ _mm256_loadu_si256(reinterpret_cast<const __m256i*>(notes.Outputs[i].data() + lineIndex)) };
+            __m256i segmentCounts{ CountActiveSegmentsBatch(digits) };
+            __m256i isSpecial{ _mm256_or_si256(
+                _mm256_or_si256(_mm256_cmpeq_epi8(segmentCounts, _mm256_set1_epi8(2)), _mm256_cmpeq_epi8(segmentCounts, _mm256_set1_epi8(3))),
+                _mm256_or_si256(_mm256_cmpeq_epi8(segmentCounts, _mm256_set1_epi8(4)), _mm256_cmpeq_epi8(segmentCounts, _mm256_set1_epi8(7)))) };
+            specialDigitCount += CountSetBits((u32)_mm256_movemask_epi8(isSpecial));
+        }
+    }
+#endif
+
+    for (; lineIndex < lastLine; ++lineIndex)
+    {
+        for (u32 i = 0; i < K_OUTPUT_COUNT; ++i)
+        {
+            if (IsSpecialSegmentCount(CountActiveSegmentCount(notes.Outputs[i][lineIndex])))
             {
                 ++specialDigitCount;
             }
@@ -118,90 +445,167 @@ u32 CountOutputSpecialDigits(const Notes& notes)
     return specialDigitCount;
 }
 
-u8 PopMatchingPattern(std::vector<u8>& unmappedDigits, u8 pattern, u32 extraActiveSegments)
+u64 CountTotalOutputValues(const Notes& notes, size_t firstLine, size_t lastLine)
 {
-    u8 foundDigit{};
-    for (u8 digit : unmappedDigits)
+    u64 totalOutputValues{};
+    size_t lineIndex{ firstLine };
+
+#if defined(__AVX2__)
+    __m256i outputSums{ _mm256_setzero_si256() };
+    for (; lineIndex + K_BATCH_LINE_COUNT <= lastLine; lineIndex += K_BATCH_LINE_COUNT)
     {
-        if ((digit & pattern & SEGMENT_MASK) == (pattern & SEGMENT_MASK))
+        __m256i inputs[K_INPUT_COUNT];
+        for (u32 i = 0; i < K_INPUT_COUNT; ++i)
+        {
+            inputs[i] = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(notes.Inputs[i].data() + lineIndex));
+        }
+
+        __m128i lowDigits[K_OUTPUT_COUNT];
+        __m128i highDigits[K_OUTPUT_COUNT];
+        for (u32 i = 0; i < K_OUTPUT_COUNT; ++i)
         {
-            if (CountActiveSegmentCount((digit & ~pattern) & SEGMENT_MASK) == extraActiveSegments)
+            __m256i outputs{ _mm256_loadu_si256(reinterpret_cast<const __m256i*>(notes.Outputs[i].data() + lineIndex)) };
+            __m256i signatures{ _mm256_setzero_si256() };
+            for (u32 j = 0; j < K_INPUT_COUNT; ++j)
             {
-                foundDigit = digit;
-                break;
+                signatures = _mm256_add_epi8(signatures, CountActiveSegmentsBatch(_mm256_and_si256(outputs, inputs[j])));
             }
+
+            __m256i digits{ LookupSignaturesBatch(signatures) };
+            lowDigits[i] = _mm256_castsi256_si128(digits);
+            highDigits[i] = _mm256_extracti128_si256(digits, 1);
         }
+
+        outputSums = _mm256_add_epi64(outputSums, SumOutputValuesBatch(lowDigits));
+        outputSums = _mm256_add_epi64(outputSums, SumOutputValuesBatch(highDigits));
     }
+    totalOutputValues = SumLanes(outputSums);
+#endif
 
-    unmappedDigits.erase(std::remove(unmappedDigits.begin(), unmappedDigits.end(), foundDigit));
+    for (; lineIndex < lastLine; ++lineIndex)
+    {
+        NotesLine line{};
+        GetNotesLine(notes, lineIndex, line);
+        totalOutputValues += ComputeOutputValue(line);
+    }
 
-    return foundDigit;
+    return totalOutputValues;
 }
 
-void DecodeInputMapping(const NotesLine& line, u8 num2Seg[K_INPUT_COUNT])
+struct NotesReport
+{
+    u64 SpecialDigitCount{};
+    u64 TotalOutputValues{};
+    size_t ErrorOffset{};
+    bool IsMalformed{};
+};
+
+bool ReadInput(Day08::MappedFile& mappedFile)
 {
-    std::vector<u8> unmappedDigits(line.Inputs, line.Inputs + K_INPUT_COUNT);
+    static const char* inputFile{ "input.txt" };
+    return mappedFile.Open(inputFile);
+}
 
-    static constexpr u8 NO_PATTERN{ 0 };
-    num2Seg[1] = PopMatchingPattern(unmappedDigits, NO_PATTERN, 2);
-    num2Seg[4] = PopMatchingPattern(unmappedDigits, NO_PATTERN, 4);
-    num2Seg[7] = PopMatchingPattern(unmappedDigits, NO_PATTERN, 3);
-    num2Seg[8] = PopMatchingPattern(unmappedDigits, NO_PATTERN, 7);
+// Offset just past the first line break at or after offset, or size if there is none.
+size_t FindNextLineStart(const char* data, size_t size, size_t offset)
+{
+    const char* lineBreak{ std::find(data + std::min(offset, size), data + size, '\n') };
+    return (lineBreak == data + size) ? size : (size_t)(lineBreak - data) + 1;
+}
 
-    num2Seg[0] = PopMatchingPattern(unmappedDigits, (num2Seg[8] & ~num2Seg[4]) | num2Seg[1], 1);
-    num2Seg[2] = PopMatchingPattern(unmappedDigits, num2Seg[8] & ~num2Seg[4], 2);
-    num2Seg[9] = PopMatchingPattern(unmappedDigits, num2Seg[4] | num2Seg[7], 1);
+// Parses and decodes the text in blocks small enough for their notes to stay in cache.
+void AnalyzeNotesChunk(const char* data, size_t size, NotesReport& report)
+{
+    Notes notes{};
+    size_t blockStart{};
+    while (blockStart < size)
+    {
+        size_t blockEnd{ FindNextLineStart(data, size, blockStart + K_PIPELINE_BLOCK_SIZE) };
+        const char* blockText{ data + blockStart };
+        size_t blockSize{ blockEnd - blockStart };
 
-    u8 botSegment{ (u8)((num2Seg[9] & ~(num2Seg[4] | num2Seg[7])) & SEGMENT_MASK) };
-    u8 midSegment{ (u8)(~num2Seg[0] & SEGMENT_MASK) };
+        size_t blockLineCount{ CountNoteLines(blockText, blockSize) };
+        if (blockLineCount > notes.LineCount)
+        {
+            ResizeNotes(notes, blockLineCount);
+        }
 
-    num2Seg[3] = PopMatchingPattern(unmappedDigits, num2Seg[7] | botSegment | midSegment, 0);
-    num2Seg[6] = PopMatchingPattern(unmappedDigits, num2Seg[8] & ~num2Seg[1], 1);
-    num2Seg[5] = unmappedDigits[0];
+        size_t parsedLineCount{};
+        size_t errorOffset{};
+        if (!ParseNotes(notes, 0, blockText, blockSize, parsedLineCount, errorOffset))
+        {
+            report.ErrorOffset = blockStart + errorOffset;
+            report.IsMalformed = true;
+            return;
+        }
+        report.SpecialDigitCount += CountOutputSpecialDigits(notes, 0, parsedLineCount);
+        report.TotalOutputValues += CountTotalOutputValues(notes, 0, parsedLineCount);
+
+        blockStart = blockEnd;
+    }
 }
 
-u8 FindMappedValue(u8 searchedDigit, u8 num2SegMapping[K_INPUT_COUNT])
+NotesReport AnalyzeNotesParallel(const char* data, size_t size, u32 threadCount)
 {
-    auto foundIt{ std::find(num2SegMapping, num2SegMapping + K_INPUT_COUNT, searchedDigit) };
-    if (foundIt != num2SegMapping + K_INPUT_COUNT)
+    threadCount = (u32)std::max<size_t>(1, std::min<size_t>(threadCount, size / K_PIPELINE_BLOCK_SIZE));
+
+    std::vector<size_t> chunkStarts(threadCount + 1, size);
+    chunkStarts[0] = 0;
+    for (u32 chunk = 1; chunk < threadCount; ++chunk)
     {
-        return foundIt - num2SegMapping;
+        chunkStarts[chunk] = FindNextLineStart(data, size, std::max(chunkStarts[chunk - 1], chunk * (size / threadCount)));
     }
 
-    FMT_ASSERT(false, "Failed to find mapping.");
-    return 0;
-}
+    std::vector<NotesReport> partialReports(threadCount);
+    std::vector<std::thread> workers{};
+    for (u32 chunk = 1; chunk < threadCount; ++chunk)
+    {
+        workers.emplace_back([&, chunk]()
+            {
+                AnalyzeNotesChunk(data + chunkStarts[chunk], chunkStarts[chunk + 1] - chunkStarts[chunk], partialReports[chunk]);
+            });
+    }
 
-u32 ComputeOutputValue(const NotesLine& line)
-{
-    u8 num2SegMapping[K_INPUT_COUNT]{};
-    DecodeInputMapping(line, num2SegMapping);
+    AnalyzeNotesChunk(data, chunkStarts[1], partialReports[0]);
 
-    u32 outputValue{};
-    for (u8 digit : line.Outputs)
+    for (std::thread& worker : workers)
     {
-        u8 mappedValue{ FindMappedValue(digit, num2SegMapping) };
-        outputValue = (outputValue * 10) + (u32)mappedValue;
+        worker.join();
     }
-    return outputValue;
-}
 
-u32 CountTotalOutputValues(const Notes& notes)
-{
-    auto countOutputValue = [](u32 total, const NotesLine& line) { return total + ComputeOutputValue(line); };
-    return std::accumulate(notes.begin(), notes.end(), 0, countOutputValue);
+    NotesReport report{};
+    for (u32 chunk = 0; chunk < threadCount; ++chunk)
+    {
+        const NotesReport& partialReport{ partialReports[chunk] };
+        if (partialReport.IsMalformed)
+        {
+            report.ErrorOffset = chunkStarts[chunk] + partialReport.ErrorOffset;
+            report.IsMalformed = true;
+            break;
+        }
+        report.SpecialDigitCount += partialReport.SpecialDigitCount;
+        report.TotalOutputValues += partialReport.TotalOutputValues;
+    }
+    return report;
 }
 
 int main()
 {
-    Notes notes;
-    if (ReadInput(notes))
+    Day08::MappedFile mappedFile{};
+    if (ReadInput(mappedFile))
     {
-        u32 outputSpecialDigits{ CountOutputSpecialDigits(notes) };
-        fmt::print("Output Special Digits (1, 4, 7, 8): {}.\n", outputSpecialDigits);
+        u32 threadCount{ std::max(1U, std::thread::hardware_concurrency()) };
+        NotesReport report{ AnalyzeNotesParallel(mappedFile.GetData(), mappedFile.GetSize(), threadCount) };
+        if (report.IsMalformed)
+        {
+            const char* data{ mappedFile.GetData() };
+            size_t lineNumber{ (size_t)std::count(data, data + report.ErrorOffset, '\n') + 1 };
+            fmt::print("Malformed notes line {}: expected {} patterns.\n", lineNumber, K_PATTERN_SLOT_COUNT);
+            return -1;
+        }
 
-        u32 totalOutputValues{ CountTotalOutputValues(notes) };
-        fmt::print("Total Output Values: {}.\n", totalOutputValues);
+        fmt::print("Output Special Digits (1, 4, 7, 8): {}.\n", report.SpecialDigitCount);
+        fmt::print("Total Output Values: {}.\n", report.TotalOutputValues);
     }
     else
     {
@@ -0,0 +1,140 @@
+#include "mappedfile.h"
+
+#if defined(_WIN32)
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace Day08
+{
+    MappedFile::~MappedFile()
+    {
+        Close();
+    }
+
+#if defined(_WIN32)
+    bool MappedFile::Open(const char* filePath)
+    {
+        Close();
+
+        HANDLE fileHandle{ CreateFileA(filePath, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr) };
+        if (fileHandle == INVALID_HANDLE_VALUE)
+        {
+            return false;
+        }
+        m_FileHandle = fileHandle;
+
+        LARGE_INTEGER fileSize{};
+        if (!GetFileSizeEx(fileHandle, &fileSize))
+        {
+            Close();
+            return false;
+        }
+
+        m_Size = (size_t)fileSize.QuadPart;
+        if (m_Size > 0)
+        {
+            m_MappingHandle = CreateFileMappingA(fileHandle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+            if (m_MappingHandle == nullptr)
+            {
+                Close();
+                return false;
+            }
+
+            m_Data = static_cast<const char*>(MapViewOfFile(m_MappingHandle, FILE_MAP_READ, 0, 0, 0));
+            if (m_Data == nullptr)
+            {
+                Close();
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    void MappedFile::Close()
+    {
+        if (m_Data != nullptr)
+        {
+            UnmapViewOfFile(m_Data);
+        }
+        if (m_MappingHandle != nullptr)
+        {
+            CloseHandle(m_MappingHandle);
+        }
+        if (m_FileHandle != nullptr)
+        {
+            CloseHandle(m_FileHandle);
+        }
+
+        m_Data = nullptr;
+        m_Size = 0;
+        m_MappingHandle = nullptr;
+        m_FileHandle = nullptr;
+    }
+#else
+    bool MappedFile::Open(const char* filePath)
+    {
+        Close();
+
+        m_FileDescriptor = open(filePath, O_RDONLY);
+        if (m_FileDescriptor < 0)
+        {
+            return false;
+        }
+
+        struct stat fileStatus{};
+        if (fstat(m_FileDescriptor, &fileStatus) != 0)
+        {
+            Close();
+            return false;
+        }
+
+        m_Size = (size_t)fileStatus.st_size;
+        if (m_Size > 0)
+        {
+            void* mappedData{ mmap(nullptr, m_Size, PROT_READ, MAP_PRIVATE, m_FileDescriptor, 0) };
+            if (mappedData == MAP_FAILED)
+            {
+                Close();
+                return false;
+            }
+
+            madvise(mappedData, m_Size, MADV_SEQUENTIAL);
+            m_Data = static_cast<const char*>(mappedData);
+        }
+
+        return true;
+    }
+
+    void MappedFile::Close()
+    {
+        if (m_Data != nullptr)
+        {
+            munmap(const_cast<char*>(m_Data), m_Size);
+        }
+        if (m_FileDescriptor >= 0)
+        {
+            close(m_FileDescriptor);
+        }
+
+        m_Data = nullptr;
+        m_Size = 0;
+        m_FileDescriptor = -1;
+    }
+#endif
+
+    const char* MappedFile::GetData() const
+    {
+        return m_Data;
+    }
+
+    size_t MappedFile::GetSize() const
+    {
+        return m_Size;
+    }
+}
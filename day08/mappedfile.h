@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstddef>
+
+namespace Day08
+{
+    // Read-only view of a whole file mapped in memory.
+    class MappedFile
+    {
+    public:
+        MappedFile() = default;
+        ~MappedFile();
+
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+
+        bool Open(const char* filePath);
+        void Close();
+
+        const char* GetData() const;
+        size_t GetSize() const;
+
+    private:
+        const char* m_Data{};
+        size_t m_Size{};
+#if defined(_WIN32)
+        void* m_FileHandle{};
+        void* m_MappingHandle{};
+#else
+        int m_FileDescriptor{ -1 };
+#endif
+    };
+}
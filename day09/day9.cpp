@@ -1,31 +1,75 @@
 ﻿#include <algorithm>
+#include <cstring>
 #include <fstream>
 #include <functional>
+#include <iterator>
 #include <limits>
 #include <memory>
 #include <numeric>
+#include <queue>
 #include <string>
+#include <thread>
 #include <vector>
 
 #include <fmt/core.h>
 
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
 
 using u8 = std::uint8_t;
-using i32 = std::int32_t;
 using u32 = std::uint32_t;
+using u64 = std::uint64_t;
 
-static constexpr size_t K_MAP_WIDTH{ 100 };
-static constexpr size_t K_MAP_HEIGHT{ 100 };
-static constexpr size_t K_MAP_CELL_COUNT{ K_MAP_WIDTH * K_MAP_HEIGHT };
 static constexpr u32 K_TOP_BASSIN_COUNT{ 3 };
-static constexpr i32 NO_BASIN_ID{ std::numeric_limits<i32>::max() };
-using HeightMap = u8[K_MAP_HEIGHT][K_MAP_WIDTH];
-using BasinMap = i32[K_MAP_HEIGHT][K_MAP_WIDTH];
+static constexpr u8 K_BASIN_BORDER_HEIGHT{ 9 };
+static constexpr u32 NO_BASIN_ID{ std::numeric_limits<u32>::max() };
+static constexpr u32 K_ROW_ALIGNMENT{ 32 };
+static constexpr u32 K_MIN_TILE_ROW_COUNT{ 64 };
 
-struct Vec2
+// Rows are stored with a border of K_BASIN_BORDER_HEIGHT cells all around the map, and padded
+// with more border cells up to Stride, so neighbours never need bounds checks and a row can be
+// read K_ROW_ALIGNMENT cells at a time.
+struct HeightMap
 {
-    u32 x{};
-    u32 y{};
+    std::vector<u8> Cells{};
+    u32 Width{};
+    u32 Height{};
+    u32 Stride{};
+};
+
+// Union-find over provisional basin labels. A root is always the smallest label of its set.
+struct BasinLabels
+{
+    std::vector<u32> Parents{};
+};
+
+// A horizontal run of basin cells in the last streamed row, [Start, End) with a compact label.
+struct BasinRun
+{
+    u32 Start{};
+    u32 End{};
+    u32 Label{};
+};
+
+// Min-heap holding the largest basin sizes seen so far.
+struct TopBasinSizes
+{
+    std::priority_queue<u64, std::vector<u64>, std::greater<u64>> Sizes{};
+    u32 Capacity{ K_TOP_BASSIN_COUNT };
+};
+
+// A band of full rows labelled independently. Only the labels of its first and last rows are
+// kept, to merge basins across the seams with the neighbouring tiles.
+struct BasinTile
+{
+    u32 FirstRow{};
+    u32 RowCount{};
+    u32 LabelOffset{};
+    BasinLabels Labels{};
+    std::vector<u32> LabelSizes{};
+    std::vector<u32> FirstRowLabels{};
+    std::vector<u32> LastRowLabels{};
 };
 
 bool ReadInput(HeightMap& heightMap)
@@ -36,160 +80,434 @@ bool ReadInput(HeightMap& heightMap)
     bool readSucceeded{ inputStream.is_open() };
     if (readSucceeded)
     {
-        u32 y{};
         std::string lineText;
         while (std::getline(inputStream, lineText))
         {
-            std::transform(lineText.begin(), lineText.end(), &heightMap[y][0],
+            if (!lineText.empty() && lineText.back() == '\r')
+            {
+                lineText.pop_back();
+            }
+            if (lineText.empty())
+            {
+                continue;
+            }
+
+            if (heightMap.Height == 0)
+            {
+                heightMap.Width = (u32)lineText.size();
+                heightMap.Stride = (heightMap.Width + K_ROW_ALIGNMENT - 1) / K_ROW_ALIGNMENT * K_ROW_ALIGNMENT + K_ROW_ALIGNMENT;
+                heightMap.Cells.assign(heightMap.Stride, K_BASIN_BORDER_HEIGHT);
+            }
+            bool isDigitRow{ std::all_of(lineText.begin(), lineText.end(), [](char c) { return c >= '0' && c <= '9'; }) };
+            if (lineText.size() != heightMap.Width || !isDigitRow)
+            {
+                fmt::print("Row {} must hold {} digits.\n", heightMap.Height + 1, heightMap.Width);
+                readSucceeded = false;
+                break;
+            }
+
+            size_t rowStart{ heightMap.Cells.size() };
+            heightMap.Cells.resize(rowStart + heightMap.Stride, K_BASIN_BORDER_HEIGHT);
+            std::transform(lineText.begin(), lineText.end(), heightMap.Cells.begin() + rowStart + 1,
                 [](char c) { return (u8)(c - '0'); });
-            ++y;
+            ++heightMap.Height;
         }
 
+        heightMap.Cells.resize(heightMap.Cells.size() + heightMap.Stride, K_BASIN_BORDER_HEIGHT);
+
         inputStream.close();
     }
 
     return readSucceeded;
 }
 
-u32 ComputeLowerPointCount(const HeightMap& heightMap, const Vec2& pos)
+inline size_t GetCellIndex(const HeightMap& heightMap, u32 x, u32 y)
 {
-    u32 lowerPointCount{};
-
-    u8 height{ heightMap[pos.y][pos.x] };
-    if (pos.x > 0 && heightMap[pos.y][pos.x - 1] <= height) { ++lowerPointCount; }
-    if (pos.y > 0 && heightMap[pos.y - 1][pos.x] <= height) { ++lowerPointCount; }
-    if (pos.x < K_MAP_WIDTH - 1 && heightMap[pos.y][pos.x + 1] <= height) { ++lowerPointCount; }
-    if (pos.y < K_MAP_HEIGHT - 1 && heightMap[pos.y + 1][pos.x] <= height) { ++lowerPointCount; }
+    return (size_t)(y + 1) * heightMap.Stride + (x + 1);
+}
 
-    return lowerPointCount;
+inline bool IsLowPoint(const HeightMap& heightMap, size_t cellIndex)
+{
+    const u8* cell{ heightMap.Cells.data() + cellIndex };
+    u8 height{ *cell };
+    return cell[-1] > height && cell[1] > height && cell[-(ptrdiff_t)heightMap.Stride] > height && cell[heightMap.Stride] > height;
 }
 
-void ComputeLowPoints(const HeightMap& heightMap, std::vector<Vec2>& lowPoints)
+u64 ComputeTotalRiskLevel(const HeightMap& heightMap)
 {
-    for (u32 y = 0; y < K_MAP_HEIGHT; ++y)
+    u64 totalRiskLevel{};
+
+    for (u32 y = 0; y < heightMap.Height; ++y)
     {
-        for (u32 x = 0; x < K_MAP_WIDTH; ++x)
+        size_t cellIndex{ GetCellIndex(heightMap, 0, y) };
+        size_t rowEnd{ cellIndex + heightMap.Width };
+
+#if defined(__AVX2__)
+        // Border cells past the end of the row are never low points, so the last block needs no masking.
+        __m256i riskSums{ _mm256_setzero_si256() };
+        for (; cellIndex < rowEnd; cellIndex += K_ROW_ALIGNMENT)
+        {
+            const u8* cell{ heightMap.Cells.data() + cellIndex };
+            __m256i heights{ _mm256_loadu_si256(reinterpret_cast<const __m256i*>(cell)) };
+            __m256i left{ _mm256_loadu_si256(reinterpret_cast<const __m256i*>(cell - 1)) };
+            __m256i right{ _mm256_loadu_si256(reinterpret_cast<const __m256i*>(cell + 1)) };
+            __m256i up{ _mm256_loadu_si256(reinterpret_cast<const __m256i*>(cell - heightMap.Stride)) };
+            __m256i down{ _mm256_loadu_si256(reinterpret_cast<const __m256i*>(cell + heightMap.Stride)) };
+
+            __m256i isLowPoint{ _mm256_and_si256(
+                _mm256_and_si256(_mm256_cmpgt_epi8(left, heights), _mm256_cmpgt_epi8(right, heights)),
+                _mm256_and_si256(_mm256_cmpgt_epi8(up, heights), _mm256_cmpgt_epi8(down, heights))) };
+            __m256i riskLevels{ _mm256_and_si256(isLowPoint, _mm256_add_epi8(heights, _mm256_set1_epi8(1))) };
+            riskSums = _mm256_add_epi64(riskSums, _mm256_sad_epu8(riskLevels, _mm256_setzero_si256()));
+        }
+
+        alignas(32) u64 laneSums[4]{};
+        _mm256_store_si256(reinterpret_cast<__m256i*>(laneSums), riskSums);
+        totalRiskLevel += laneSums[0] + laneSums[1] + laneSums[2] + laneSums[3];
+#else
+        for (; cellIndex < rowEnd; ++cellIndex)
         {
-            Vec2 pos{ x, y };
-            if (ComputeLowerPointCount(heightMap, pos) == 0)
+            if (IsLowPoint(heightMap, cellIndex))
             {
-                lowPoints.push_back(pos);
+                totalRiskLevel += heightMap.Cells[cellIndex] + 1;
             }
         }
+#endif
     }
+
+    return totalRiskLevel;
+}
+
+u32 CreateBasinLabel(BasinLabels& labels)
+{
+    u32 newLabel{ (u32)labels.Parents.size() };
+    labels.Parents.push_back(newLabel);
+    return newLabel;
+}
+
+u32 FindBasinRoot(BasinLabels& labels, u32 label)
+{
+    while (labels.Parents[label] != label)
+    {
+        labels.Parents[label] = labels.Parents[labels.Parents[label]];
+        label = labels.Parents[label];
+    }
+    return label;
 }
 
-u32 ComputeTotalRiskLevel(const HeightMap& heightMap, const std::vector<Vec2>& lowPoints)
+u32 MergeBasinLabels(BasinLabels& labels, u32 label1, u32 label2)
 {
-    auto addRiskLevel = [&heightMap](u32 total, const Vec2& pos) { return total + heightMap[pos.y][pos.x] + 1; };
-    return std::accumulate(lowPoints.begin(), lowPoints.end(), 0, addRiskLevel);
+    u32 root1{ FindBasinRoot(labels, label1) };
+    u32 root2{ FindBasinRoot(labels, label2) };
+    u32 mergedRoot{ std::min(root1, root2) };
+    labels.Parents[root1] = mergedRoot;
+    labels.Parents[root2] = mergedRoot;
+    return mergedRoot;
 }
 
-void ValidateBasinID(i32& currentID, i32 newID)
+// Basins are the connected regions of cells below K_BASIN_BORDER_HEIGHT. Each cell gets a label
+// from its left and upper neighbours, and the union-find records when both neighbours disagree.
+// Only the previous row's labels are needed, and at the end every label's cell count is
+// gathered on its root, which gives the tile's basin size histogram.
+void LabelBasinTile(BasinTile& tile, const HeightMap& heightMap)
 {
-    if (currentID == -1)
+    u32 width{ heightMap.Width };
+    std::vector<u32> previousRowLabels(width + 1, NO_BASIN_ID);
+    std::vector<u32> currentRowLabels(width + 1, NO_BASIN_ID);
+
+    for (u32 y = tile.FirstRow; y < tile.FirstRow + tile.RowCount; ++y)
     {
-        currentID = newID;
+        const u8* row{ heightMap.Cells.data() + GetCellIndex(heightMap, 0, y) };
+        for (u32 x = 0; x < width; ++x)
+        {
+            u32& cellLabel{ currentRowLabels[x + 1] };
+            if (row[x] == K_BASIN_BORDER_HEIGHT)
+            {
+                cellLabel = NO_BASIN_ID;
+                continue;
+            }
+
+            u32 leftLabel{ currentRowLabels[x] };
+            u32 upLabel{ previousRowLabels[x + 1] };
+
+            if (leftLabel != NO_BASIN_ID && upLabel != NO_BASIN_ID)
+            {
+                cellLabel = (leftLabel == upLabel) ? leftLabel : MergeBasinLabels(tile.Labels, leftLabel, upLabel);
+            }
+            else if (leftLabel != NO_BASIN_ID || upLabel != NO_BASIN_ID)
+            {
+                cellLabel = std::min(leftLabel, upLabel);
+            }
+            else
+            {
+                cellLabel = CreateBasinLabel(tile.Labels);
+                tile.LabelSizes.push_back(0);
+            }
+            ++tile.LabelSizes[cellLabel];
+        }
+
+        if (y == tile.FirstRow)
+        {
+            tile.FirstRowLabels.assign(currentRowLabels.begin() + 1, currentRowLabels.end());
+        }
+        std::swap(previousRowLabels, currentRowLabels);
     }
-    else if (newID != -1)
+    tile.LastRowLabels.assign(previousRowLabels.begin() + 1, previousRowLabels.end());
+
+    for (u32 label = 0; label < tile.LabelSizes.size(); ++label)
     {
-        if (currentID != newID)
+        u32 root{ FindBasinRoot(tile.Labels, label) };
+        if (root != label)
         {
-            currentID = NO_BASIN_ID;
+            tile.LabelSizes[root] += tile.LabelSizes[label];
+            tile.LabelSizes[label] = 0;
         }
     }
+
+    auto resolveLabel = [&tile](u32& label) { if (label != NO_BASIN_ID) { label = FindBasinRoot(tile.Labels, label); } };
+    std::for_each(tile.FirstRowLabels.begin(), tile.FirstRowLabels.end(), resolveLabel);
+    std::for_each(tile.LastRowLabels.begin(), tile.LastRowLabels.end(), resolveLabel);
 }
 
-i32 FindBasinID(BasinMap& basinMap, const HeightMap& heightMap, u32 x, u32 y)
+void LabelBasinTiles(std::vector<BasinTile>& tiles, const HeightMap& heightMap, u32 threadCount)
 {
-    if (basinMap[y][x] >= 0)
+    u32 tileCount{ std::max(1U, std::min(threadCount, heightMap.Height / K_MIN_TILE_ROW_COUNT)) };
+    u32 rowsPerTile{ (heightMap.Height + tileCount - 1) / tileCount };
+
+    tiles.clear();
+    for (u32 firstRow = 0; firstRow < heightMap.Height; firstRow += rowsPerTile)
     {
-        return basinMap[y][x];
+        BasinTile& tile{ tiles.emplace_back() };
+        tile.FirstRow = firstRow;
+        tile.RowCount = std::min(rowsPerTile, heightMap.Height - firstRow);
     }
-    if (heightMap[y][x] == 9)
+
+    std::vector<std::thread> workers{};
+    for (size_t tileIndex = 1; tileIndex < tiles.size(); ++tileIndex)
     {
-        basinMap[y][x] = NO_BASIN_ID;
-        return basinMap[y][x];
+        workers.emplace_back([&tiles, &heightMap, tileIndex]() { LabelBasinTile(tiles[tileIndex], heightMap); });
     }
-    else
+    if (!tiles.empty())
+    {
+        LabelBasinTile(tiles[0], heightMap);
+    }
+    for (std::thread& worker : workers)
     {
-        i32 basinID{ -1 };
+        worker.join();
+    }
+}
+
+// Tile labels are made global by offsetting them, then basins touching across a seam are merged
+// and each tile's size histogram is added to the merged basins.
+void ComputeAllBasinSizes(const HeightMap& heightMap, std::vector<u32>& basinSizes, u32 threadCount)
+{
+    std::vector<BasinTile> tiles{};
+    LabelBasinTiles(tiles, heightMap, threadCount);
+
+    BasinLabels seamLabels{};
+    for (BasinTile& tile : tiles)
+    {
+        tile.LabelOffset = (u32)seamLabels.Parents.size();
+        for (size_t label = 0; label < tile.LabelSizes.size(); ++label)
+        {
+            CreateBasinLabel(seamLabels);
+        }
+    }
 
-        u8 height{ heightMap[y][x] };
-        if (basinID != NO_BASIN_ID && x > 0 && heightMap[y][x - 1] < height) { ValidateBasinID(basinID, FindBasinID(basinMap, heightMap, x - 1, y)); }
-        if (basinID != NO_BASIN_ID && y > 0 && heightMap[y - 1][x] < height) { ValidateBasinID(basinID, FindBasinID(basinMap, heightMap, x, y - 1)); }
-        if (basinID != NO_BASIN_ID && x < K_MAP_WIDTH - 1 && heightMap[y][x + 1] < height) { ValidateBasinID(basinID, FindBasinID(basinMap, heightMap, x + 1, y)); }
-        if (basinID != NO_BASIN_ID && y < K_MAP_HEIGHT - 1 && heightMap[y + 1][x] < height) { ValidateBasinID(basinID, FindBasinID(basinMap, heightMap, x, y + 1)); }
+    for (size_t tileIndex = 1; tileIndex < tiles.size(); ++tileIndex)
+    {
+        const BasinTile& upperTile{ tiles[tileIndex - 1] };
+        const BasinTile& lowerTile{ tiles[tileIndex] };
+        for (u32 x = 0; x < heightMap.Width; ++x)
+        {
+            u32 upperLabel{ upperTile.LastRowLabels[x] };
+            u32 lowerLabel{ lowerTile.FirstRowLabels[x] };
+            if (upperLabel != NO_BASIN_ID && lowerLabel != NO_BASIN_ID)
+            {
+                MergeBasinLabels(seamLabels, upperTile.LabelOffset + upperLabel, lowerTile.LabelOffset + lowerLabel);
+            }
+        }
+    }
 
-        basinMap[y][x] = basinID;
-        return basinID;
+    std::vector<u32> mergedSizes(seamLabels.Parents.size(), 0);
+    for (const BasinTile& tile : tiles)
+    {
+        for (u32 label = 0; label < tile.LabelSizes.size(); ++label)
+        {
+            if (tile.LabelSizes[label] > 0)
+            {
+                mergedSizes[FindBasinRoot(seamLabels, tile.LabelOffset + label)] += tile.LabelSizes[label];
+            }
+        }
     }
+
+    basinSizes.clear();
+    std::copy_if(mergedSizes.begin(), mergedSizes.end(), std::back_inserter(basinSizes), [](u32 size) { return size > 0; });
 }
 
-void FillBasinMap(BasinMap& basinMap, const HeightMap& heightMap, const std::vector<Vec2>& lowPoints)
+u64 ComputeTopBasinSizes(const HeightMap& heightMap)
 {
-    std::fill(&basinMap[0][0], &basinMap[0][0] + K_MAP_CELL_COUNT, -1);
+    std::vector<u32> basinSizes{};
+    ComputeAllBasinSizes(heightMap, basinSizes, std::max(1U, std::thread::hardware_concurrency()));
+
+    size_t topBasinCount{ std::min<size_t>(K_TOP_BASSIN_COUNT, basinSizes.size()) };
+    std::nth_element(basinSizes.begin(), basinSizes.begin() + topBasinCount, basinSizes.end(), std::greater{});
+    return std::accumulate(basinSizes.begin(), basinSizes.begin() + topBasinCount, 1ULL, std::multiplies{});
+}
 
-    i32 maxBasinID{ (i32)lowPoints.size() };
-    for (i32 basinID = 0; basinID < maxBasinID; ++basinID)
+void AddBasinSize(TopBasinSizes& topSizes, u64 basinSize)
+{
+    if (topSizes.Sizes.size() < topSizes.Capacity)
+    {
+        topSizes.Sizes.push(basinSize);
+    }
+    else if (basinSize > topSizes.Sizes.top())
     {
-        const Vec2& pos{ lowPoints[basinID] };
-        basinMap[pos.y][pos.x] = basinID;
+        topSizes.Sizes.pop();
+        topSizes.Sizes.push(basinSize);
     }
+}
 
-    for (u32 y = 0; y < K_MAP_HEIGHT; ++y)
+void ReadBasinRuns(const std::string& lineText, std::vector<BasinRun>& runs)
+{
+    runs.clear();
+    u32 width{ (u32)lineText.size() };
+    for (u32 x = 0; x < width; ++x)
     {
-        for (u32 x = 0; x < K_MAP_WIDTH; ++x)
+        if (lineText[x] != '0' + K_BASIN_BORDER_HEIGHT)
         {
-            basinMap[y][x] = FindBasinID(basinMap, heightMap, x, y);
+            u32 runStart{ x };
+            while (x < width && lineText[x] != '0' + K_BASIN_BORDER_HEIGHT)
+            {
+                ++x;
+            }
+            runs.push_back({ runStart, x, 0 });
         }
     }
 }
 
-void ComputeAllBasinSizes(const HeightMap& heightMap, const std::vector<Vec2>& lowPoints, std::vector<u32>& basinSizes)
+// Reads the map one row at a time and only keeps the basin runs of the previous row. For each new
+// row, a union-find over the previous row's labels and the new row's runs merges basins that touch
+// vertically. A basin with no run in the new row can no longer grow, so its size is reported to
+// onBasinClosed and it is forgotten. Memory is O(width) whatever the height of the map.
+template <typename TOnBasinClosed>
+void StreamBasinSizes(std::istream& inputStream, TOnBasinClosed onBasinClosed)
 {
-    BasinMap basinMap{};
-    FillBasinMap(basinMap, heightMap, lowPoints);
+    std::vector<BasinRun> previousRuns{};
+    std::vector<u64> previousSizes{};
+    std::vector<BasinRun> currentRuns{};
+    std::vector<u64> mergedSizes{};
+    std::vector<u32> newLabels{};
+    BasinLabels labels{};
 
-    basinSizes.resize(lowPoints.size(), 0);
-    for (u32 y = 0; y < K_MAP_HEIGHT; ++y)
+    std::string lineText{};
+    while (std::getline(inputStream, lineText))
     {
-        for (u32 x = 0; x < K_MAP_WIDTH; ++x)
+        if (!lineText.empty() && lineText.back() == '\r')
+        {
+            lineText.pop_back();
+        }
+        ReadBasinRuns(lineText, currentRuns);
+
+        u32 previousLabelCount{ (u32)previousSizes.size() };
+        u32 labelCount{ previousLabelCount + (u32)currentRuns.size() };
+        labels.Parents.resize(labelCount);
+        std::iota(labels.Parents.begin(), labels.Parents.end(), 0);
+
+        size_t previousRunIndex{};
+        for (u32 runIndex = 0; runIndex < currentRuns.size(); ++runIndex)
+        {
+            const BasinRun& run{ currentRuns[runIndex] };
+            while (previousRunIndex < previousRuns.size() && previousRuns[previousRunIndex].End <= run.Start)
+            {
+                ++previousRunIndex;
+            }
+            for (size_t i = previousRunIndex; i < previousRuns.size() && previousRuns[i].Start < run.End; ++i)
+            {
+                MergeBasinLabels(labels, previousRuns[i].Label, previousLabelCount + runIndex);
+            }
+        }
+
+        mergedSizes.assign(labelCount, 0);
+        for (u32 label = 0; label < previousLabelCount; ++label)
+        {
+            mergedSizes[FindBasinRoot(labels, label)] += previousSizes[label];
+        }
+        for (u32 runIndex = 0; runIndex < currentRuns.size(); ++runIndex)
+        {
+            const BasinRun& run{ currentRuns[runIndex] };
+            mergedSizes[FindBasinRoot(labels, previousLabelCount + runIndex)] += run.End - run.Start;
+        }
+
+        newLabels.assign(labelCount, NO_BASIN_ID);
+        previousSizes.clear();
+        for (u32 runIndex = 0; runIndex < currentRuns.size(); ++runIndex)
+        {
+            u32 root{ FindBasinRoot(labels, previousLabelCount + runIndex) };
+            if (newLabels[root] == NO_BASIN_ID)
+            {
+                newLabels[root] = (u32)previousSizes.size();
+                previousSizes.push_back(mergedSizes[root]);
+            }
+            currentRuns[runIndex].Label = newLabels[root];
+        }
+
+        for (u32 label = 0; label < previousLabelCount; ++label)
         {
-            i32 basinID{ basinMap[y][x] };
-            if (basinID >= 0 && basinID < basinSizes.size())
+            if (FindBasinRoot(labels, label) == label && newLabels[label] == NO_BASIN_ID)
             {
-                ++basinSizes[basinID];
+                onBasinClosed(mergedSizes[label]);
             }
         }
+
+        std::swap(previousRuns, currentRuns);
     }
+
+    std::for_each(previousSizes.begin(), previousSizes.end(), onBasinClosed);
 }
 
-u32 ComputeTopBasinSizes(const HeightMap& heightMap, const std::vector<Vec2>& lowPoints)
+u64 ComputeTopBasinSizesStreaming(std::istream& inputStream)
 {
-    std::vector<u32> basinSizes{};
-    ComputeAllBasinSizes(heightMap, lowPoints, basinSizes);
+    TopBasinSizes topSizes{};
+    StreamBasinSizes(inputStream, [&topSizes](u64 basinSize) { AddBasinSize(topSizes, basinSize); });
 
-    std::nth_element(basinSizes.begin(), basinSizes.begin() + K_TOP_BASSIN_COUNT, basinSizes.end(), std::greater{});
-    return std::accumulate(basinSizes.begin(), basinSizes.begin() + K_TOP_BASSIN_COUNT, 1UL, std::multiplies{});
+    u64 topBasinSizes{ 1 };
+    for (; !topSizes.Sizes.empty(); topSizes.Sizes.pop())
+    {
+        topBasinSizes *= topSizes.Sizes.top();
+    }
+    return topBasinSizes;
 }
 
-int main()
+int main(int argc, char** argv)
 {
+    if (argc > 1 && std::strcmp(argv[1], "--stream") == 0)
+    {
+        const char* inputFile{ argc > 2 ? argv[2] : "input.txt" };
+        std::ifstream inputStream{ inputFile };
+        if (!inputStream.is_open())
+        {
+            fmt::print("Failed to open input file.\n");
+            return -1;
+        }
+
+        u64 topBasinSizes{ ComputeTopBasinSizesStreaming(inputStream) };
+        fmt::print("Top Basin Sizes: {}.\n", topBasinSizes);
+        return 0;
+    }
+
     HeightMap heightMap{};
     if (ReadInput(heightMap))
     {
-        std::vector<Vec2> lowPoints{};
-        ComputeLowPoints(heightMap, lowPoints);
-        u32 totalRiskLevel{ ComputeTotalRiskLevel(heightMap, lowPoints) };
+        u64 totalRiskLevel{ ComputeTotalRiskLevel(heightMap) };
         fmt::print("Total Risk Level: {}.\n", totalRiskLevel);
 
-        u32 topBasinSizes{ ComputeTopBasinSizes(heightMap, lowPoints) };
+        u64 topBasinSizes{ ComputeTopBasinSizes(heightMap) };
         fmt::print("Top Basin Sizes: {}.\n", topBasinSizes);
     }
     else
     {
-        fmt::print("Failed to open input file.\n");
+        fmt::print("Failed to read input file.\n");
     }
     return 0;
 }
\ No newline at end of file
@@ -1,19 +1,85 @@
-﻿#include <fstream>
-#include <numeric>
-#include <stack>
+﻿#include <algorithm>
+#include <array>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <fstream>
+#include <iostream>
+#include <queue>
 #include <string>
+#include <string_view>
+#include <thread>
+#include <tuple>
 #include <vector>
 
 #include <fmt/core.h>
 
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
 
+
+using u8 = std::uint8_t;
+using u32 = std::uint32_t;
 using u64 = std::uint64_t;
 
+static constexpr u64 K_AUTO_COMPLETE_SCORE_BASE{ 5 };
+static constexpr size_t K_MIN_LINES_PER_THREAD{ 1 << 14 };
+static constexpr size_t K_DEPTH_SCAN_BLOCK_SIZE{ 32 };
+static constexpr size_t K_MIN_DEPTH_SCAN_LINE_LENGTH{ 4096 };
+static constexpr u64 K_STREAM_REPORT_INTERVAL{ 100000 };
+
+// Brackets are identified by their auto-complete points: 1 for (), 2 for [], 3 for {} and 4 for <>.
+struct BracketInfo
+{
+    u8 Points{};
+    u8 IsOpen{};
+    u8 IsClose{};
+};
+
+constexpr std::array<BracketInfo, 256> BuildBracketTable()
+{
+    std::array<BracketInfo, 256> brackets{};
+    constexpr char openBrackets[]{ '(', '[', '{', '<' };
+    constexpr char closeBrackets[]{ ')', ']', '}', '>' };
+    for (u8 i = 0; i < 4; ++i)
+    {
+        brackets[(u8)openBrackets[i]] = { (u8)(i + 1), 1, 0 };
+        brackets[(u8)closeBrackets[i]] = { (u8)(i + 1), 0, 1 };
+    }
+    return brackets;
+}
+
+static constexpr std::array<BracketInfo, 256> K_BRACKETS{ BuildBracketTable() };
+static constexpr u64 K_ILLEGAL_CHAR_ERROR_SCORES[]{ 0, 3, 57, 1197, 25137 };
+
+// A corrupted line has a non-zero error score, an incomplete line a non-zero auto-complete score.
 struct LineSyntaxReport
 {
-    bool IsValid{};
-    char IlllegalChar{};
-    std::string RequiredAutoComplete{};
+    u64 ErrorScore{};
+    u64 AutoCompleteScore{};
+};
+
+// Expected closing brackets, as auto-complete points, on top of a 0 sentinel that no closing
+// bracket matches. Reused from one line to the next.
+using SyntaxStack = std::vector<u8>;
+
+// Auto-complete scores split around the middle one: the upper heap holds the middle score and
+// everything above it, the lower heap everything below, so the middle is always the upper top.
+struct RunningMedian
+{
+    std::priority_queue<u64> Lower{};
+    std::priority_queue<u64, std::vector<u64>, std::greater<u64>> Upper{};
+};
+
+// Scores of one chunk of lines, kept by a single worker until every chunk is merged.
+struct LinesScoreChunk
+{
+    u64 ErrorTotal{};
+    std::vector<u64> AutoCompleteScores{};
 };
 
 bool ReadInput(std::vector<std::string>& lines)
@@ -36,99 +102,234 @@ bool ReadInput(std::vector<std::string>& lines)
     return readSucceeded;
 }
 
-void ComputeLineSyntaxReport(const std::string& line, LineSyntaxReport& syntaxReport)
+inline u32 CountTrailingZeros32(u32 bits)
 {
-    std::vector<char> expectedChars{};
+#if defined(_MSC_VER)
+    unsigned long index{};
+    _BitScanForward(&index, bits);
+    return (u32)index;
+#else
+    return (u32)__builtin_ctz(bits);
+#endif
+}
 
-    for (char c : line)
+// Every character is handled without branching on its kind: its points are always written just
+// above the top of the stack, which only becomes a push when the depth grows.
+// Returns the points of the first illegal closing bracket, 0 if there is none.
+u8 ValidateBracketsScalar(const char* data, size_t size, u8* expectedBrackets, size_t& depth)
+{
+    for (size_t i = 0; i < size; ++i)
     {
-        switch (c)
+        BracketInfo bracket{ K_BRACKETS[(u8)data[i]] };
+        expectedBrackets[depth + 1] = bracket.Points;
+        if (bracket.IsClose & (expectedBrackets[depth] != bracket.Points))
         {
-            case '(': { expectedChars.push_back(')'); break; }
-            case '[': { expectedChars.push_back(']'); break; }
-            case '{': { expectedChars.push_back('}'); break; }
-            case '<': { expectedChars.push_back('>'); break; }
-
-            case ')':
-            case ']':
-            case '}':
-            case '>':
-            {
-                if (c != expectedChars.back())
-                {
-                    syntaxReport.IsValid = false;
-                    syntaxReport.IlllegalChar = c;
-                    return;
-                }
-                expectedChars.pop_back();
-                break;
-            }
+            return bracket.Points;
         }
+        depth = depth + bracket.IsOpen - bracket.IsClose;
     }
+    return 0;
+}
 
-    syntaxReport.IsValid = expectedChars.empty();
-    std::copy(expectedChars.rbegin(), expectedChars.rend(), std::back_inserter(syntaxReport.RequiredAutoComplete));
+#if defined(__AVX2__)
+// Brackets are classified with one bit per character, '(' ')' '[' ']' '{' '}' '<' '>' from bit 0
+// to 7: the low nibble table gives the characters sharing a low nibble, the high one likewise.
+inline __m256i ClassifyBrackets(__m256i chars)
+{
+    const __m256i lowNibbleClasses{ _mm256_setr_epi8(
+        0, 0, 0, 0, 0, 0, 0, 0, 0x01, 0x02, 0, 0x14, 0x40, 0x28, (char)0x80, 0,
+        0, 0, 0, 0, 0, 0, 0, 0, 0x01, 0x02, 0, 0x14, 0x40, 0x28, (char)0x80, 0) };
+    const __m256i highNibbleClasses{ _mm256_setr_epi8(
+        0, 0, 0x03, (char)0xC0, 0, 0x0C, 0, 0x30, 0, 0, 0, 0, 0, 0, 0, 0,
+        0, 0, 0x03, (char)0xC0, 0, 0x0C, 0, 0x30, 0, 0, 0, 0, 0, 0, 0, 0) };
+    const __m256i nibbleMask{ _mm256_set1_epi8(0x0F) };
 
-    return;
+    __m256i lowNibbles{ _mm256_and_si256(chars, nibbleMask) };
+    __m256i highNibbles{ _mm256_and_si256(_mm256_srli_epi16(chars, 4), nibbleMask) };
+    return _mm256_and_si256(_mm256_shuffle_epi8(lowNibbleClasses, lowNibbles), _mm256_shuffle_epi8(highNibbleClasses, highNibbles));
 }
 
-u64 ComputeIllegalCharErrorScore(char illegalCharacter)
+inline __m256i ComputeBracketPoints(__m256i classes)
 {
-    u64 errorScore{};
+    const __m256i lowNibblePoints{ _mm256_setr_epi8(
+        0, 1, 1, 0, 2, 0, 0, 0, 2, 0, 0, 0, 0, 0, 0, 0,
+        0, 1, 1, 0, 2, 0, 0, 0, 2, 0, 0, 0, 0, 0, 0, 0) };
+    const __m256i highNibblePoints{ _mm256_setr_epi8(
+        0, 3, 3, 0, 4, 0, 0, 0, 4, 0, 0, 0, 0, 0, 0, 0,
+        0, 3, 3, 0, 4, 0, 0, 0, 4, 0, 0, 0, 0, 0, 0, 0) };
+    const __m256i nibbleMask{ _mm256_set1_epi8(0x0F) };
 
-    switch (illegalCharacter)
-    {
-        case ')': { errorScore = 3; break; }
-        case ']': { errorScore = 57; break; }
-        case '}': { errorScore = 1197; break; }
-        case '>': { errorScore = 25137; break; }
-    }
-
-    return errorScore;
+    __m256i lowPoints{ _mm256_shuffle_epi8(lowNibblePoints, _mm256_and_si256(classes, nibbleMask)) };
+    __m256i highPoints{ _mm256_shuffle_epi8(highNibblePoints, _mm256_and_si256(_mm256_srli_epi16(classes, 4), nibbleMask)) };
+    return _mm256_or_si256(lowPoints, highPoints);
 }
 
-u64 ComputeAutoCorrectScore(const std::string& autoCorrectText)
+// Inclusive prefix sum of 32 signed bytes.
+inline __m256i ComputePrefixSum(__m256i values)
 {
-    u64 score{};
+    values = _mm256_add_epi8(values, _mm256_slli_si256(values, 1));
+    values = _mm256_add_epi8(values, _mm256_slli_si256(values, 2));
+    values = _mm256_add_epi8(values, _mm256_slli_si256(values, 4));
+    values = _mm256_add_epi8(values, _mm256_slli_si256(values, 8));
+    __m256i lowLaneTotal{ _mm256_shuffle_epi8(_mm256_permute2x128_si256(values, values, 0x08), _mm256_set1_epi8(15)) };
+    return _mm256_add_epi8(values, lowLaneTotal);
+}
 
-    for (char c : autoCorrectText)
+// The nesting depth after every character of a block is computed up front, so each bracket knows
+// its stack slot without waiting on the previous one: an opening bracket writes its points at the
+// new top, a closing one reads the top and rewrites it in place. An opening bracket directly
+// followed by a closing one is checked in bulk and never touches the stack. Closing brackets whose
+// slot did not hold their points are mismatch candidates; the first one of a block is the first
+// illegal character, since the stack is exact until then. Blocks that could pop below the bottom
+// of the stack are left to the scalar validator.
+u8 ValidateBracketsSIMD(const char* data, size_t size, u8* expectedBrackets, size_t& depth)
+{
+    size_t offset{};
+    for (; offset + K_DEPTH_SCAN_BLOCK_SIZE < size; offset += K_DEPTH_SCAN_BLOCK_SIZE)
     {
-        score *= 5;
-        switch (c)
+        if (depth <= K_DEPTH_SCAN_BLOCK_SIZE)
+        {
+            u8 errorPoints{ ValidateBracketsScalar(data + offset, K_DEPTH_SCAN_BLOCK_SIZE, expectedBrackets, depth) };
+            if (errorPoints != 0)
+            {
+                return errorPoints;
+            }
+            continue;
+        }
+
+        __m256i chars{ _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + offset)) };
+        __m256i nextChars{ _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + offset + 1)) };
+        __m256i classes{ ClassifyBrackets(chars) };
+        __m256i isOpen{ _mm256_cmpgt_epi8(_mm256_and_si256(classes, _mm256_set1_epi8(0x55)), _mm256_setzero_si256()) };
+        __m256i isClose{ _mm256_xor_si256(_mm256_cmpeq_epi8(_mm256_and_si256(classes, _mm256_set1_epi8((char)0xAA)), _mm256_setzero_si256()), _mm256_set1_epi8(-1)) };
+        __m256i depths{ ComputePrefixSum(_mm256_sub_epi8(isClose, isOpen)) };
+        __m256i slots{ _mm256_add_epi8(_mm256_add_epi8(depths, isOpen), _mm256_set1_epi8(1)) };
+        __m256i points{ ComputeBracketPoints(classes) };
+        __m256i nextPoints{ ComputeBracketPoints(ClassifyBrackets(nextChars)) };
+
+        u32 openBits{ (u32)_mm256_movemask_epi8(isOpen) };
+        u32 closeBits{ (u32)_mm256_movemask_epi8(isClose) };
+        u32 pairBits{ openBits & (closeBits >> 1) };
+        u32 unmatchedPairBits{ pairBits & ~(u32)_mm256_movemask_epi8(_mm256_cmpeq_epi8(points, nextPoints)) };
+        u32 stackBits{ (openBits | closeBits) & ~(pairBits | (pairBits << 1)) };
+
+        alignas(32) std::int8_t blockSlots[K_DEPTH_SCAN_BLOCK_SIZE];
+        alignas(32) u8 blockPoints[K_DEPTH_SCAN_BLOCK_SIZE];
+        alignas(32) u8 previousPoints[K_DEPTH_SCAN_BLOCK_SIZE];
+        _mm256_store_si256(reinterpret_cast<__m256i*>(blockSlots), slots);
+        _mm256_store_si256(reinterpret_cast<__m256i*>(blockPoints), points);
+        _mm256_store_si256(reinterpret_cast<__m256i*>(previousPoints), points);
+
+        u8* stackTop{ expectedBrackets + depth };
+        for (; stackBits != 0; stackBits &= stackBits - 1)
         {
-            case ')': { score += 1; break; }
-            case ']': { score += 2; break; }
-            case '}': { score += 3; break; }
-            case '>': { score += 4; break; }
+            u32 i{ CountTrailingZeros32(stackBits) };
+            u8* slot{ stackTop + blockSlots[i] };
+            previousPoints[i] = *slot;
+            *slot = blockPoints[i];
         }
+
+        __m256i isMatched{ _mm256_cmpeq_epi8(_mm256_load_si256(reinterpret_cast<const __m256i*>(previousPoints)), points) };
+        u32 candidateBits{ ((u32)_mm256_movemask_epi8(isMatched) ^ ~0U) & closeBits };
+        candidateBits |= unmatchedPairBits << 1;
+        if (candidateBits != 0)
+        {
+            return blockPoints[CountTrailingZeros32(candidateBits)];
+        }
+        depth += (std::int8_t)_mm256_extract_epi8(depths, K_DEPTH_SCAN_BLOCK_SIZE - 1);
     }
 
-    return score;
+    return ValidateBracketsScalar(data + offset, size - offset, expectedBrackets, depth);
 }
+#endif
 
-std::tuple<u64, u64> ComputeLinesScores(const std::vector<std::string>& lines)
+void ComputeLineSyntaxReport(std::string_view line, SyntaxStack& stack, LineSyntaxReport& syntaxReport)
 {
-    u64 errorTotal{};
+    if (stack.size() < line.size() + 2)
+    {
+        stack.resize(line.size() + 2);
+    }
+
+    u8* expectedBrackets{ stack.data() };
+    expectedBrackets[0] = 0;
+    size_t depth{};
 
-    std::vector<u64> autoCorrectScores{};
+#if defined(__AVX2__)
+    u8 errorPoints{ line.size() >= K_MIN_DEPTH_SCAN_LINE_LENGTH
+        ? ValidateBracketsSIMD(line.data(), line.size(), expectedBrackets, depth)
+        : ValidateBracketsScalar(line.data(), line.size(), expectedBrackets, depth) };
+#else
+    u8 errorPoints{ ValidateBracketsScalar(line.data(), line.size(), expectedBrackets, depth) };
+#endif
+    if (errorPoints != 0)
+    {
+        syntaxReport.ErrorScore = K_ILLEGAL_CHAR_ERROR_SCORES[errorPoints];
+        return;
+    }
+
+    u64 autoCompleteScore{};
+    for (; depth > 0; --depth)
+    {
+        autoCompleteScore = autoCompleteScore * K_AUTO_COMPLETE_SCORE_BASE + expectedBrackets[depth];
+    }
+    syntaxReport.AutoCompleteScore = autoCompleteScore;
+}
 
-    for (const std::string& line : lines)
+void ScoreLinesChunk(const std::vector<std::string>& lines, size_t firstLine, size_t lastLine, LinesScoreChunk& chunk)
+{
+    SyntaxStack stack{};
+    for (size_t lineIndex = firstLine; lineIndex < lastLine; ++lineIndex)
     {
         LineSyntaxReport report{};
-        ComputeLineSyntaxReport(line, report);
+        ComputeLineSyntaxReport(lines[lineIndex], stack, report);
 
-        if (!report.IsValid)
+        chunk.ErrorTotal += report.ErrorScore;
+        if (report.AutoCompleteScore != 0)
         {
-            if (report.IlllegalChar != 0)
-            {
-                errorTotal += ComputeIllegalCharErrorScore(report.IlllegalChar);
-            }
-            else
-            {
-                autoCorrectScores.push_back(ComputeAutoCorrectScore(report.RequiredAutoComplete));
-            }
+            chunk.AutoCompleteScores.push_back(report.AutoCompleteScore);
         }
     }
+}
+
+std::tuple<u64, u64> ComputeLinesScores(const std::vector<std::string>& lines, u32 threadCount)
+{
+    size_t chunkCount{ std::max<size_t>(1, std::min<size_t>(threadCount, lines.size() / K_MIN_LINES_PER_THREAD)) };
+    size_t linesPerChunk{ (lines.size() + chunkCount - 1) / chunkCount };
+
+    std::vector<LinesScoreChunk> chunks(chunkCount);
+    std::vector<std::thread> workers{};
+    for (size_t chunkIndex = 1; chunkIndex < chunkCount; ++chunkIndex)
+    {
+        size_t firstLine{ std::min(lines.size(), chunkIndex * linesPerChunk) };
+        size_t lastLine{ std::min(lines.size(), firstLine + linesPerChunk) };
+        workers.emplace_back([&lines, &chunks, chunkIndex, firstLine, lastLine]()
+            { ScoreLinesChunk(lines, firstLine, lastLine, chunks[chunkIndex]); });
+    }
+    ScoreLinesChunk(lines, 0, std::min(lines.size(), linesPerChunk), chunks[0]);
+    for (std::thread& worker : workers)
+    {
+        worker.join();
+    }
+
+    u64 errorTotal{};
+    size_t autoCompleteCount{};
+    for (const LinesScoreChunk& chunk : chunks)
+    {
+        errorTotal += chunk.ErrorTotal;
+        autoCompleteCount += chunk.AutoCompleteScores.size();
+    }
+
+    if (autoCompleteCount == 0)
+    {
+        return { errorTotal, 0 };
+    }
+
+    std::vector<u64>& autoCorrectScores{ chunks[0].AutoCompleteScores };
+    autoCorrectScores.reserve(autoCompleteCount);
+    for (size_t chunkIndex = 1; chunkIndex < chunkCount; ++chunkIndex)
+    {
+        autoCorrectScores.insert(autoCorrectScores.end(), chunks[chunkIndex].AutoCompleteScores.begin(), chunks[chunkIndex].AutoCompleteScores.end());
+    }
 
     size_t midElementIndex{ autoCorrectScores.size() / 2 };
     std::nth_element(autoCorrectScores.begin(), autoCorrectScores.begin() + midElementIndex, autoCorrectScores.end());
@@ -137,12 +338,93 @@ std::tuple<u64, u64> ComputeLinesScores(const std::vector<std::string>& lines)
     return { errorTotal, midAutocorrectScore };
 }
 
-int main()
+void AddRunningMedianValue(RunningMedian& median, u64 value)
+{
+    if (median.Upper.empty() || value >= median.Upper.top())
+    {
+        median.Upper.push(value);
+    }
+    else
+    {
+        median.Lower.push(value);
+    }
+
+    if (median.Upper.size() > median.Lower.size() + 1)
+    {
+        median.Lower.push(median.Upper.top());
+        median.Upper.pop();
+    }
+    else if (median.Lower.size() > median.Upper.size())
+    {
+        median.Upper.push(median.Lower.top());
+        median.Lower.pop();
+    }
+}
+
+u64 GetRunningMedianValue(const RunningMedian& median)
+{
+    return median.Upper.empty() ? 0 : median.Upper.top();
+}
+
+// Lines are scored as soon as they are read and only the heaps of auto-complete scores are kept.
+// The running scores are reported every reportInterval lines, and once more at the end.
+void StreamLinesScores(std::istream& inputStream, u64 reportInterval)
+{
+    u64 errorTotal{};
+    RunningMedian autoCompleteMedian{};
+    SyntaxStack stack{};
+
+    std::string lineText{};
+    u64 lineCount{};
+    while (std::getline(inputStream, lineText))
+    {
+        LineSyntaxReport report{};
+        ComputeLineSyntaxReport(lineText, stack, report);
+        ++lineCount;
+
+        errorTotal += report.ErrorScore;
+        if (report.AutoCompleteScore != 0)
+        {
+            AddRunningMedianValue(autoCompleteMedian, report.AutoCompleteScore);
+        }
+
+        if (lineCount % reportInterval == 0)
+        {
+            fmt::print("Line {}: Total Syntax Error Score: {}, Middle Auto-correct Score: {}.\n",
+                lineCount, errorTotal, GetRunningMedianValue(autoCompleteMedian));
+        }
+    }
+
+    fmt::print("Total Syntax Error Score: {}.\n", errorTotal);
+    fmt::print("Middle Auto-correct Score: {}.\n", GetRunningMedianValue(autoCompleteMedian));
+}
+
+// --stream [report interval] scores the lines of stdin as they arrive instead of reading input.txt.
+int main(int argc, char** argv)
 {
+    if (argc > 1 && std::strcmp(argv[1], "--stream") == 0)
+    {
+        u64 reportInterval{ K_STREAM_REPORT_INTERVAL };
+        if (argc > 2)
+        {
+            char* intervalEnd{};
+            reportInterval = std::strtoull(argv[2], &intervalEnd, 10);
+            if (intervalEnd == argv[2] || *intervalEnd != '\0' || argv[2][0] == '-' || reportInterval == 0)
+            {
+                fmt::print("Report interval must be a positive line count.\n");
+                return -1;
+            }
+        }
+
+        std::ios::sync_with_stdio(false);
+        StreamLinesScores(std::cin, reportInterval);
+        return 0;
+    }
+
     std::vector<std::string> lines{};
     if (ReadInput(lines))
     {
-        auto [errorTotal, midAutocorrectScore] { ComputeLinesScores(lines) };
+        auto [errorTotal, midAutocorrectScore] { ComputeLinesScores(lines, std::max(1U, std::thread::hardware_concurrency())) };
         fmt::print("Total Syntax Error Score: {}.\n", errorTotal);
         fmt::print("Middle Auto-correct Score: {}.\n", midAutocorrectScore);
     }
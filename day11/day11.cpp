@@ -1,22 +1,114 @@
-﻿#include <fstream>
+﻿#include <algorithm>
+#include <array>
+#include <cctype>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <random>
 #include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
 #include <vector>
-#include <Windows.h>
 
 #include <fmt/core.h>
+#include <fmt/format.h>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#if defined(_WIN32)
+#include <Windows.h>
+#endif
 
 
 using u8 = std::uint8_t;
 using i32 = std::uint32_t;
+using u64 = std::uint64_t;
 
 static constexpr i32 K_SIMULATION_LENGTH{ 100 };
+static constexpr u8 K_FLASH_ENERGY_LEVEL{ 10 };
+static constexpr i32 K_ENERGY_BIT_COUNT{ 4 };
+static constexpr i32 K_WORD_BIT_COUNT{ 64 };
+static constexpr i32 K_FLASH_COUNTER_BIT_COUNT{ 32 };
+static constexpr i32 K_MIN_BIT_PLANE_WIDTH{ K_WORD_BIT_COUNT };
+static constexpr i32 K_MAX_BATCH_ITERATION_COUNT{ 10000 };
+static constexpr i32 K_BATCH_RANDOM_SEED{ 2021 };
+static constexpr long K_MAX_BATCH_GRID_COUNT{ 1 << 20 };
+static constexpr u64 K_FNV_OFFSET_BASIS{ 0xCBF29CE484222325ULL };
+static constexpr u64 K_FNV_PRIME{ 0x100000001B3ULL };
 
+// FlashQueue holds the cells that flashed during the current step, in the order they flashed.
 struct Grid
 {
     std::vector<u8> Cells{};
-    std::vector<bool> FlashState{};
+    std::vector<i32> FlashQueue{};
+    i32 Width{};
+    i32 Height{};
+};
+
+// Energy levels are bit-sliced: bit b of the level of cell (x, y) is bit x % 64 of word
+// y * WordsPerRow + x / 64 of EnergyPlanes[b]. Bits past the grid width are always 0.
+// Bit w % 64 of word y * MaskWordsPerRow + w / 64 of DirtyWordMasks is set when word w of row y
+// may have cells left to flash.
+struct BitPlaneGrid
+{
+    std::array<std::vector<u64>, K_ENERGY_BIT_COUNT> EnergyPlanes{};
+    std::vector<u64> Flashed{};
+    std::vector<u64> DirtyWordMasks{};
+    std::vector<u64> ColumnMasks{};
+    i32 WordsPerRow{};
+    i32 MaskWordsPerRow{};
+    i32 Width{};
+    i32 Height{};
+};
+
+// Energy levels and flashed state of one cell in all the lanes of a GridBatch.
+struct BatchCell
+{
+    std::array<u64, K_ENERGY_BIT_COUNT> EnergyPlanes{};
+    u64 Flashed{};
+};
+
+// Up to 64 grids of the same size simulated together: bit g of every word belongs to the grid in
+// lane g. Cells are surrounded by a border that never flashes, so neighbours need no bounds
+// checks. DirtyLanes holds, for each cell, the lanes in which a neighbour flashed since the cell
+// was last resolved. A lane is reloaded with the next pending grid as soon as its grid is done,
+// LaneGrids and LaneIterations tracking which grid it holds and how many steps it ran.
+// FlashCounters is a bit-sliced counter of the flashes of every lane over its first
+// K_SIMULATION_LENGTH steps.
+struct GridBatch
+{
+    std::vector<BatchCell> Cells{};
+    std::vector<u64> DirtyLanes{};
+    std::array<u64, K_FLASH_COUNTER_BIT_COUNT> FlashCounters{};
+    std::array<size_t, K_WORD_BIT_COUNT> LaneGrids{};
+    std::array<i32, K_WORD_BIT_COUNT> LaneIterations{};
+    u64 ActiveLanes{};
+    u64 SyncedLanes{};
     i32 Width{};
     i32 Height{};
+    i32 Stride{};
+};
+
+// SyncIteration is 0 for a grid that did not sync within the simulated steps, here and in
+// LongSimulationReport.
+struct GridBatchResult
+{
+    i32 FlashCounter{};
+    i32 SyncIteration{};
+};
+
+// IsFlashCounterOverflowed is set when the flash total does not fit in FlashCounter.
+struct LongSimulationReport
+{
+    u64 FlashCounter{};
+    u64 SyncIteration{};
+    bool IsFlashCounterOverflowed{};
 };
 
 bool ReadInput(Grid& grid)
@@ -27,24 +119,29 @@ bool ReadInput(Grid& grid)
     bool readSucceeded{ inputStream.is_open() };
     if (readSucceeded)
     {
-        static constexpr i32 gridWidth{ 10 };
-        static constexpr i32 gridHeight{ 10 };
-        grid.Width = gridWidth;
-        grid.Height = gridHeight;
-        grid.FlashState.resize(gridWidth * gridHeight, false);
-        grid.Cells.reserve(gridWidth * gridHeight);
-
         std::string lineText;
-        for (i32 j = 0; j < gridHeight; ++j)
+        while (std::getline(inputStream, lineText))
         {
-            std::getline(inputStream, lineText);
-            for (i32 i = 0; i < gridWidth; ++i)
+            i32 rowWidth{};
+            for (char c : lineText)
             {
-                char c{ lineText[i] };
-                if (std::isdigit(c))
+                if (std::isdigit((unsigned char)c))
                 {
                     grid.Cells.push_back((u8)(c - '0'));
+                    ++rowWidth;
+                }
+            }
+
+            if (rowWidth > 0)
+            {
+                if (grid.Height > 0 && rowWidth != grid.Width)
+                {
+                    fmt::print("Row {} holds {} cells, expected {}.\n", grid.Height + 1, rowWidth, grid.Width);
+                    readSucceeded = false;
+                    break;
                 }
+                grid.Width = rowWidth;
+                ++grid.Height;
             }
         }
 
@@ -58,14 +155,16 @@ void TryUpdateCell(Grid& grid, i32 x, i32 y)
 {
     if (x >= 0 && x < grid.Width && y >= 0 && y < grid.Height)
     {
-        ++grid.Cells[x + y * grid.Width];
+        i32 cellIndex{ x + y * grid.Width };
+        if (++grid.Cells[cellIndex] == K_FLASH_ENERGY_LEVEL)
+        {
+            grid.FlashQueue.push_back(cellIndex);
+        }
     }
 }
 
 void FlashCell(Grid& grid, i32 x, i32 y)
 {
-    grid.FlashState[x + y * grid.Width] = true;
-
     TryUpdateCell(grid, x - 1, y - 1);
     TryUpdateCell(grid, x    , y - 1);
     TryUpdateCell(grid, x + 1, y - 1);
@@ -76,102 +175,909 @@ void FlashCell(Grid& grid, i32 x, i32 y)
     TryUpdateCell(grid, x + 1, y + 1);
 }
 
-i32 ResolveFlashes(Grid& grid)
+// A cell is queued only when its energy reaches exactly 10, so it flashes once per step however
+// many neighbours flash after it.
+i32 SimulateGridIteration(Grid& grid)
 {
-    i32 flashes{};
     i32 cellCount{ grid.Width * grid.Height };
+    grid.FlashQueue.clear();
+    for (i32 i = 0; i < cellCount; ++i)
+    {
+        if (++grid.Cells[i] == K_FLASH_ENERGY_LEVEL)
+        {
+            grid.FlashQueue.push_back(i);
+        }
+    }
+
+    for (size_t queueIndex = 0; queueIndex < grid.FlashQueue.size(); ++queueIndex)
+    {
+        i32 cellIndex{ grid.FlashQueue[queueIndex] };
+        FlashCell(grid, cellIndex % grid.Width, cellIndex / grid.Width);
+    }
+
+    for (i32 cellIndex : grid.FlashQueue)
+    {
+        grid.Cells[cellIndex] = 0;
+    }
+
+    return (i32)grid.FlashQueue.size();
+}
+
+u64 HashGridState(const Grid& grid)
+{
+    u64 stateHash{ K_FNV_OFFSET_BASIS };
+    for (u8 cell : grid.Cells)
+    {
+        stateHash = (stateHash ^ cell) * K_FNV_PRIME;
+    }
+    return stateHash;
+}
+
+void AddFlashCounter(LongSimulationReport& report, u64 flashCounter)
+{
+    if (flashCounter > std::numeric_limits<u64>::max() - report.FlashCounter)
+    {
+        report.IsFlashCounterOverflowed = true;
+    }
+    report.FlashCounter += flashCounter;
+}
+
+void AddSimulatedIteration(LongSimulationReport& report, const Grid& grid, i32 flashCounter, u64 iteration)
+{
+    AddFlashCounter(report, flashCounter);
+    if (report.SyncIteration == 0 && flashCounter == grid.Width * grid.Height)
+    {
+        report.SyncIteration = iteration;
+    }
+}
+
+// Simulates one presumed cycle from the current state and checks that it comes back to it, which
+// also rules out a hash collision. Once confirmed, the remaining whole cycles are skipped using the
+// flashes of each cycle step. Returns whether the report is complete.
+bool TryFastForwardCycle(Grid& grid, u64 cycleLength, u64& iteration, u64 iterationCount, LongSimulationReport& report)
+{
+    std::vector<u8> cycleStartCells{ grid.Cells };
+    std::vector<i32> cycleFlashCounters{};
+    for (u64 i = 0; i < cycleLength; ++i)
+    {
+        if (iteration == iterationCount)
+        {
+            return true;
+        }
+        i32 flashCounter{ SimulateGridIteration(grid) };
+        AddSimulatedIteration(report, grid, flashCounter, ++iteration);
+        cycleFlashCounters.push_back(flashCounter);
+    }
+
+    if (grid.Cells != cycleStartCells)
+    {
+        return false;
+    }
+
+    u64 cycleFlashCounter{};
+    for (i32 flashCounter : cycleFlashCounters)
+    {
+        cycleFlashCounter += flashCounter;
+    }
+
+    u64 remainingIterations{ iterationCount - iteration };
+    u64 remainingCycleCount{ remainingIterations / cycleLength };
+    if (cycleFlashCounter != 0 && remainingCycleCount > std::numeric_limits<u64>::max() / cycleFlashCounter)
+    {
+        report.IsFlashCounterOverflowed = true;
+    }
+    AddFlashCounter(report, remainingCycleCount * cycleFlashCounter);
+    for (u64 i = 0; i < remainingIterations % cycleLength; ++i)
+    {
+        AddFlashCounter(report, cycleFlashCounters[i]);
+    }
+    iteration = iterationCount;
+    return true;
+}
+
+// Every state is hashed before being simulated; meeting a hash again gives a candidate cycle.
+// A grid that has not synced once a full cycle has been simulated never syncs.
+void SimulateLongHorizon(Grid& grid, u64 iterationCount, LongSimulationReport& report)
+{
+    std::unordered_map<u64, u64> stateIterations{};
+    u64 iteration{};
+    while (iteration < iterationCount)
+    {
+        auto [stateIt, isNewState] { stateIterations.try_emplace(HashGridState(grid), iteration) };
+        if (!isNewState)
+        {
+            u64 cycleLength{ iteration - stateIt->second };
+            stateIt->second = iteration;
+            if (TryFastForwardCycle(grid, cycleLength, iteration, iterationCount, report))
+            {
+                break;
+            }
+            continue;
+        }
+
+        i32 flashCounter{ SimulateGridIteration(grid) };
+        AddSimulatedIteration(report, grid, flashCounter, ++iteration);
+    }
+}
+
+inline i32 CountSetBits64(u64 bits)
+{
+#if defined(_MSC_VER)
+    return (i32)__popcnt64(bits);
+#else
+    return (i32)__builtin_popcountll(bits);
+#endif
+}
+
+inline i32 CountTrailingZeros64(u64 bits)
+{
+#if defined(_MSC_VER)
+    unsigned long index{};
+    _BitScanForward64(&index, bits);
+    return (i32)index;
+#else
+    return (i32)__builtin_ctzll(bits);
+#endif
+}
+
+inline void AddBits(u64 a, u64 b, u64 carryIn, u64& sum, u64& carryOut)
+{
+    sum = a ^ b ^ carryIn;
+    carryOut = (a & b) | (carryIn & (a ^ b));
+}
+
+void BuildBitPlaneGrid(const Grid& grid, BitPlaneGrid& bitPlaneGrid)
+{
+    bitPlaneGrid.Width = grid.Width;
+    bitPlaneGrid.Height = grid.Height;
+    bitPlaneGrid.WordsPerRow = (grid.Width + K_WORD_BIT_COUNT - 1) / K_WORD_BIT_COUNT;
+    bitPlaneGrid.MaskWordsPerRow = (bitPlaneGrid.WordsPerRow + K_WORD_BIT_COUNT - 1) / K_WORD_BIT_COUNT;
+
+    size_t wordCount{ (size_t)bitPlaneGrid.WordsPerRow * grid.Height };
+    for (std::vector<u64>& plane : bitPlaneGrid.EnergyPlanes)
+    {
+        plane.assign(wordCount, 0);
+    }
+    bitPlaneGrid.Flashed.assign(wordCount, 0);
+    bitPlaneGrid.DirtyWordMasks.assign((size_t)bitPlaneGrid.MaskWordsPerRow * grid.Height, 0);
+
+    bitPlaneGrid.ColumnMasks.assign(bitPlaneGrid.WordsPerRow, ~0ULL);
+    if (grid.Width % K_WORD_BIT_COUNT != 0)
+    {
+        bitPlaneGrid.ColumnMasks.back() = (1ULL << (grid.Width % K_WORD_BIT_COUNT)) - 1;
+    }
 
     for (i32 j = 0; j < grid.Height; ++j)
     {
         for (i32 i = 0; i < grid.Width; ++i)
         {
-            i32 cellIndex{ i + j * grid.Width };
-            if (!grid.FlashState[cellIndex] && grid.Cells[cellIndex] > 9)
+            size_t wordIndex{ (size_t)j * bitPlaneGrid.WordsPerRow + i / K_WORD_BIT_COUNT };
+            u64 cellBit{ 1ULL << (i % K_WORD_BIT_COUNT) };
+            u8 cell{ grid.Cells[i + j * grid.Width] };
+            for (i32 b = 0; b < K_ENERGY_BIT_COUNT; ++b)
             {
-                FlashCell(grid, i, j);
-                ++flashes;
+                if ((cell >> b) & 1)
+                {
+                    bitPlaneGrid.EnergyPlanes[b][wordIndex] |= cellBit;
+                }
             }
         }
     }
+}
 
-    return flashes;
+void CopyBitPlaneGridCells(const BitPlaneGrid& bitPlaneGrid, Grid& grid)
+{
+    for (i32 j = 0; j < grid.Height; ++j)
+    {
+        for (i32 i = 0; i < grid.Width; ++i)
+        {
+            size_t wordIndex{ (size_t)j * bitPlaneGrid.WordsPerRow + i / K_WORD_BIT_COUNT };
+            u8 cell{};
+            for (i32 b = 0; b < K_ENERGY_BIT_COUNT; ++b)
+            {
+                cell |= (u8)(((bitPlaneGrid.EnergyPlanes[b][wordIndex] >> (i % K_WORD_BIT_COUNT)) & 1) << b);
+            }
+            grid.Cells[i + j * grid.Width] = cell;
+        }
+    }
 }
 
-i32 SimulateGridIteration(Grid& grid)
+// 2-bit count of flashed cells among each cell of the word and its left and right neighbours.
+void ComputeRowFlashSums(const BitPlaneGrid& grid, i32 row, i32 word, u64& sum0, u64& sum1)
+{
+    const u64* rowFlashed{ grid.Flashed.data() + (size_t)row * grid.WordsPerRow };
+    u64 flashed{ rowFlashed[word] };
+    u64 previousWord{ word > 0 ? rowFlashed[word - 1] : 0 };
+    u64 nextWord{ word + 1 < grid.WordsPerRow ? rowFlashed[word + 1] : 0 };
+    u64 left{ (flashed << 1) | (previousWord >> (K_WORD_BIT_COUNT - 1)) };
+    u64 right{ (flashed >> 1) | (nextWord << (K_WORD_BIT_COUNT - 1)) };
+    AddBits(left, flashed, right, sum0, sum1);
+}
+
+// 5-bit energy of every cell of the word once each flashed cell of its 3x3 neighbourhood added 1.
+void ComputeFlashedEnergy(const BitPlaneGrid& grid, i32 row, i32 word, u64 (&energy)[K_ENERGY_BIT_COUNT + 1])
+{
+    u64 rowSums[3][2]{};
+    for (i32 r = 0; r < 3; ++r)
+    {
+        i32 sumRow{ row + r - 1 };
+        if (sumRow < grid.Height)
+        {
+            ComputeRowFlashSums(grid, sumRow, word, rowSums[r][0], rowSums[r][1]);
+        }
+    }
+
+    u64 count[K_ENERGY_BIT_COUNT]{};
+    u64 carry0{}, carry1{}, partial0{}, partial1{}, partial2{};
+    AddBits(rowSums[0][0], rowSums[1][0], 0, partial0, carry0);
+    AddBits(rowSums[0][1], rowSums[1][1], carry0, partial1, partial2);
+    AddBits(partial0, rowSums[2][0], 0, count[0], carry0);
+    AddBits(partial1, rowSums[2][1], carry0, count[1], carry1);
+    AddBits(partial2, carry1, 0, count[2], count[3]);
+
+    size_t wordIndex{ (size_t)row * grid.WordsPerRow + word };
+    u64 carry{};
+    for (i32 b = 0; b < K_ENERGY_BIT_COUNT; ++b)
+    {
+        AddBits(grid.EnergyPlanes[b][wordIndex], count[b], carry, energy[b], carry);
+    }
+    energy[K_ENERGY_BIT_COUNT] = carry;
+}
+
+inline u64 ComputeFlashingCells(const u64 (&energy)[K_ENERGY_BIT_COUNT + 1])
+{
+    return energy[4] | (energy[3] & (energy[2] | energy[1]));
+}
+
+void MarkWordDirty(BitPlaneGrid& grid, i32 row, i32 word)
+{
+    if (row < grid.Height && word < grid.WordsPerRow)
+    {
+        grid.DirtyWordMasks[(size_t)row * grid.MaskWordsPerRow + word / K_WORD_BIT_COUNT] |= 1ULL << (word % K_WORD_BIT_COUNT);
+    }
+}
+
+// Cells that just flashed can only make the words around them flash: the same word in the rows
+// above and below, and the words on either side when they sit on the word edge.
+void MarkFlashNeighboursDirty(BitPlaneGrid& grid, i32 row, i32 word, u64 newFlashes)
+{
+    for (i32 r = row - 1; r != row + 2; ++r)
+    {
+        if (r != row)
+        {
+            MarkWordDirty(grid, r, word);
+        }
+        if (newFlashes & 1)
+        {
+            MarkWordDirty(grid, r, word - 1);
+        }
+        if (newFlashes >> (K_WORD_BIT_COUNT - 1))
+        {
+            MarkWordDirty(grid, r, word + 1);
+        }
+    }
+}
+
+// The energy of a cell only depends on its step start level and on which of its neighbours have
+// flashed, so flashes can be resolved in any order, reading flashes found earlier in the same
+// sweep. A word is iterated until its own horizontal chains settle.
+void ResolveWordFlashes(BitPlaneGrid& grid, i32 row, i32 word)
+{
+    size_t wordIndex{ (size_t)row * grid.WordsPerRow + word };
+    u64 newFlashes{};
+    for (;;)
+    {
+        u64 energy[K_ENERGY_BIT_COUNT + 1]{};
+        ComputeFlashedEnergy(grid, row, word, energy);
+        u64 flashing{ ComputeFlashingCells(energy) & grid.ColumnMasks[word] & ~grid.Flashed[wordIndex] };
+        if (flashing == 0)
+        {
+            break;
+        }
+        grid.Flashed[wordIndex] |= flashing;
+        newFlashes |= flashing;
+    }
+
+    if (newFlashes != 0)
+    {
+        MarkFlashNeighboursDirty(grid, row, word, newFlashes);
+    }
+}
+
+bool ResolveDirtyRow(BitPlaneGrid& grid, i32 row)
 {
+    bool wasDirty{};
+    bool isDirty{ true };
+    while (isDirty)
+    {
+        isDirty = false;
+        for (i32 m = 0; m < grid.MaskWordsPerRow; ++m)
+        {
+            u64& dirtyWords{ grid.DirtyWordMasks[(size_t)row * grid.MaskWordsPerRow + m] };
+            while (dirtyWords != 0)
+            {
+                i32 bit{ CountTrailingZeros64(dirtyWords) };
+                dirtyWords &= dirtyWords - 1;
+                ResolveWordFlashes(grid, row, m * K_WORD_BIT_COUNT + bit);
+                isDirty = true;
+            }
+        }
+        wasDirty |= isDirty;
+    }
+    return wasDirty;
+}
+
+// Every cell is incremented with a bitwise ripple adder, then the rows are swept downwards and
+// upwards in turn, each flash making its neighbouring words dirty, until no word is left dirty.
+// The energy planes keep the incremented levels during the sweeps, and the flash counts are
+// only added once the set of flashed cells is final.
+i32 SimulateBitPlaneIteration(BitPlaneGrid& grid)
+{
+    bool isDirty{};
+    for (i32 row = 0; row < grid.Height; ++row)
+    {
+        for (i32 word = 0; word < grid.WordsPerRow; ++word)
+        {
+            size_t wordIndex{ (size_t)row * grid.WordsPerRow + word };
+            u64 carry{ grid.ColumnMasks[word] };
+            for (std::vector<u64>& plane : grid.EnergyPlanes)
+            {
+                u64 nextCarry{ plane[wordIndex] & carry };
+                plane[wordIndex] ^= carry;
+                carry = nextCarry;
+            }
+
+            // Levels are at most 10 here, so 10 is the only one with bits 3 and 1 set.
+            u64 flashing{ grid.EnergyPlanes[3][wordIndex] & grid.EnergyPlanes[1][wordIndex] };
+            grid.Flashed[wordIndex] = flashing;
+            if (flashing != 0)
+            {
+                MarkWordDirty(grid, row, word);
+                MarkFlashNeighboursDirty(grid, row, word, flashing);
+                isDirty = true;
+            }
+        }
+    }
+
+    bool isSweepingDown{ true };
+    while (isDirty)
+    {
+        isDirty = false;
+        for (i32 i = 0; i < grid.Height; ++i)
+        {
+            isDirty |= ResolveDirtyRow(grid, isSweepingDown ? i : grid.Height - 1 - i);
+        }
+        isSweepingDown = !isSweepingDown;
+    }
+
     i32 flashCounter{};
-    i32 cellCount{ grid.Width * grid.Height };
-    for (i32 i = 0; i < cellCount; ++i)
+    for (i32 row = 0; row < grid.Height; ++row)
     {
-        grid.FlashState[i] = false;
-        ++grid.Cells[i];
+        for (i32 word = 0; word < grid.WordsPerRow; ++word)
+        {
+            size_t wordIndex{ (size_t)row * grid.WordsPerRow + word };
+            u64 energy[K_ENERGY_BIT_COUNT + 1]{};
+            ComputeFlashedEnergy(grid, row, word, energy);
+            u64 restingCells{ ~grid.Flashed[wordIndex] & grid.ColumnMasks[word] };
+            for (i32 b = 0; b < K_ENERGY_BIT_COUNT; ++b)
+            {
+                grid.EnergyPlanes[b][wordIndex] = energy[b] & restingCells;
+            }
+            flashCounter += CountSetBits64(grid.Flashed[wordIndex]);
+        }
     }
+    return flashCounter;
+}
+
+inline i32 GetBatchCellIndex(const GridBatch& batch, i32 x, i32 y)
+{
+    return (y + 1) * batch.Stride + x + 1;
+}
 
-    while (ResolveFlashes(grid) > 0);
+void InitializeGridBatch(GridBatch& batch, i32 width, i32 height)
+{
+    batch.Width = width;
+    batch.Height = height;
+    batch.Stride = width + 2;
+    batch.Cells.assign((size_t)batch.Stride * (height + 2), {});
+    batch.DirtyLanes.assign(batch.Cells.size(), 0);
+    batch.FlashCounters.fill(0);
+    batch.ActiveLanes = 0;
+    batch.SyncedLanes = 0;
+}
 
-    for (i32 i = 0; i < cellCount; ++i)
+void LoadGridIntoLane(GridBatch& batch, const std::vector<Grid>& grids, size_t gridIndex, i32 lane)
+{
+    const Grid& grid{ grids[gridIndex] };
+    u64 laneBit{ 1ULL << lane };
+    for (i32 j = 0; j < batch.Height; ++j)
+    {
+        for (i32 i = 0; i < batch.Width; ++i)
+        {
+            u8 cell{ grid.Cells[i + j * grid.Width] };
+            BatchCell& batchCell{ batch.Cells[GetBatchCellIndex(batch, i, j)] };
+            for (i32 b = 0; b < K_ENERGY_BIT_COUNT; ++b)
+            {
+                batchCell.EnergyPlanes[b] = (batchCell.EnergyPlanes[b] & ~laneBit) | ((u64)((cell >> b) & 1) << lane);
+            }
+        }
+    }
+
+    for (u64& counterBits : batch.FlashCounters)
+    {
+        counterBits &= ~laneBit;
+    }
+    batch.LaneGrids[lane] = gridIndex;
+    batch.LaneIterations[lane] = 0;
+    batch.ActiveLanes |= laneBit;
+    batch.SyncedLanes &= ~laneBit;
+}
+
+// 5-bit energy of the cell in every lane once each flashed cell of its 3x3 neighbourhood added 1.
+// Same adder tree as ComputeFlashedEnergy, with lanes in place of columns.
+void ComputeBatchFlashedEnergy(const GridBatch& batch, i32 cellIndex, u64 (&energy)[K_ENERGY_BIT_COUNT + 1])
+{
+    u64 rowSums[3][2]{};
+    const BatchCell* rowCell{ batch.Cells.data() + cellIndex - batch.Stride };
+    for (i32 r = 0; r < 3; ++r, rowCell += batch.Stride)
+    {
+        AddBits(rowCell[-1].Flashed, rowCell[0].Flashed, rowCell[1].Flashed, rowSums[r][0], rowSums[r][1]);
+    }
+
+    u64 count[K_ENERGY_BIT_COUNT]{};
+    u64 carry0{}, carry1{}, partial0{}, partial1{}, partial2{};
+    AddBits(rowSums[0][0], rowSums[1][0], 0, partial0, carry0);
+    AddBits(rowSums[0][1], rowSums[1][1], carry0, partial1, partial2);
+    AddBits(partial0, rowSums[2][0], 0, count[0], carry0);
+    AddBits(partial1, rowSums[2][1], carry0, count[1], carry1);
+    AddBits(partial2, carry1, 0, count[2], count[3]);
+
+    const BatchCell& cell{ batch.Cells[cellIndex] };
+    u64 carry{};
+    for (i32 b = 0; b < K_ENERGY_BIT_COUNT; ++b)
+    {
+        AddBits(cell.EnergyPlanes[b], count[b], carry, energy[b], carry);
+    }
+    energy[K_ENERGY_BIT_COUNT] = carry;
+}
+
+// Border cells get marked too, but are never resolved.
+void MarkBatchNeighboursDirty(GridBatch& batch, i32 cellIndex, u64 newFlashes)
+{
+    u64* rowDirtyLanes{ batch.DirtyLanes.data() + cellIndex - batch.Stride };
+    for (i32 r = 0; r < 3; ++r, rowDirtyLanes += batch.Stride)
+    {
+        rowDirtyLanes[-1] |= newFlashes;
+        rowDirtyLanes[1] |= newFlashes;
+    }
+    batch.DirtyLanes[cellIndex - batch.Stride] |= newFlashes;
+    batch.DirtyLanes[cellIndex + batch.Stride] |= newFlashes;
+}
+
+bool ResolveBatchCellFlashes(GridBatch& batch, i32 cellIndex)
+{
+    BatchCell& cell{ batch.Cells[cellIndex] };
+    u64 dirtyLanes{ batch.DirtyLanes[cellIndex] & ~cell.Flashed };
+    batch.DirtyLanes[cellIndex] = 0;
+    if (dirtyLanes == 0)
+    {
+        return false;
+    }
+
+    u64 energy[K_ENERGY_BIT_COUNT + 1]{};
+    ComputeBatchFlashedEnergy(batch, cellIndex, energy);
+    u64 flashing{ ComputeFlashingCells(energy) & dirtyLanes };
+    if (flashing == 0)
+    {
+        return false;
+    }
+    cell.Flashed |= flashing;
+    MarkBatchNeighboursDirty(batch, cellIndex, flashing);
+    return true;
+}
+
+void AddToFlashCounters(GridBatch& batch, u64 lanes)
+{
+    u64 carry{ lanes };
+    for (i32 b = 0; b < K_FLASH_COUNTER_BIT_COUNT && carry != 0; ++b)
+    {
+        u64 nextCarry{ batch.FlashCounters[b] & carry };
+        batch.FlashCounters[b] ^= carry;
+        carry = nextCarry;
+    }
+}
+
+// The same fixpoint as SimulateBitPlaneIteration, over lanes instead of columns: every cell is
+// incremented with a ripple adder, then the dirty cells are swept forwards and backwards in turn
+// until no lane gains a flash. Flashes of countingLanes are added to FlashCounters. Returns the
+// lanes in which every cell flashed.
+u64 SimulateGridBatchIteration(GridBatch& batch, u64 countingLanes)
+{
+    bool isDirty{};
+    for (i32 j = 0; j < batch.Height; ++j)
+    {
+        for (i32 i = 0; i < batch.Width; ++i)
+        {
+            i32 cellIndex{ GetBatchCellIndex(batch, i, j) };
+            BatchCell& cell{ batch.Cells[cellIndex] };
+            u64 carry{ ~0ULL };
+            for (u64& plane : cell.EnergyPlanes)
+            {
+                u64 nextCarry{ plane & carry };
+                plane ^= carry;
+                carry = nextCarry;
+            }
+
+            // Levels are at most 10 here, so 10 is the only one with bits 3 and 1 set.
+            cell.Flashed = cell.EnergyPlanes[3] & cell.EnergyPlanes[1];
+            if (cell.Flashed != 0)
+            {
+                MarkBatchNeighboursDirty(batch, cellIndex, cell.Flashed);
+                isDirty = true;
+            }
+        }
+    }
+
+    bool isSweepingForward{ true };
+    while (isDirty)
+    {
+        isDirty = false;
+        for (i32 j = 0; j < batch.Height; ++j)
+        {
+            i32 y{ isSweepingForward ? j : batch.Height - 1 - j };
+            for (i32 i = 0; i < batch.Width; ++i)
+            {
+                i32 x{ isSweepingForward ? i : batch.Width - 1 - i };
+                isDirty |= ResolveBatchCellFlashes(batch, GetBatchCellIndex(batch, x, y));
+            }
+        }
+        isSweepingForward = !isSweepingForward;
+    }
+
+    u64 syncedLanes{ ~0ULL };
+    for (i32 j = 0; j < batch.Height; ++j)
     {
-        if (grid.FlashState[i])
+        for (i32 i = 0; i < batch.Width; ++i)
         {
-            grid.Cells[i] = 0;
-            ++flashCounter;
+            i32 cellIndex{ GetBatchCellIndex(batch, i, j) };
+            u64 energy[K_ENERGY_BIT_COUNT + 1]{};
+            ComputeBatchFlashedEnergy(batch, cellIndex, energy);
+            BatchCell& cell{ batch.Cells[cellIndex] };
+            for (i32 b = 0; b < K_ENERGY_BIT_COUNT; ++b)
+            {
+                cell.EnergyPlanes[b] = energy[b] & ~cell.Flashed;
+            }
+            syncedLanes &= cell.Flashed;
+            AddToFlashCounters(batch, cell.Flashed & countingLanes);
         }
     }
+    return syncedLanes;
+}
 
+i32 ReadLaneFlashCounter(const GridBatch& batch, i32 lane)
+{
+    i32 flashCounter{};
+    for (i32 b = 0; b < K_FLASH_COUNTER_BIT_COUNT; ++b)
+    {
+        flashCounter |= (i32)((batch.FlashCounters[b] >> lane) & 1) << b;
+    }
     return flashCounter;
 }
 
+// A grid is done once it synced and its flashes over the first steps are counted, or once it
+// reached maxIterationCount. Its lane then takes the next grid of [firstGrid, lastGrid), so a
+// grid that never syncs does not hold the other lanes back.
+void SimulateGridRange(const std::vector<Grid>& grids, size_t firstGrid, size_t lastGrid, std::vector<GridBatchResult>& results, i32 maxIterationCount)
+{
+    if (firstGrid == lastGrid)
+    {
+        return;
+    }
+
+    GridBatch batch{};
+    InitializeGridBatch(batch, grids[firstGrid].Width, grids[firstGrid].Height);
+    size_t nextGrid{ firstGrid };
+    for (i32 lane = 0; lane < K_WORD_BIT_COUNT && nextGrid < lastGrid; ++lane)
+    {
+        LoadGridIntoLane(batch, grids, nextGrid++, lane);
+    }
+
+    while (batch.ActiveLanes != 0)
+    {
+        u64 countingLanes{};
+        for (u64 lanes{ batch.ActiveLanes }; lanes != 0; lanes &= lanes - 1)
+        {
+            i32 lane{ CountTrailingZeros64(lanes) };
+            if (++batch.LaneIterations[lane] <= K_SIMULATION_LENGTH)
+            {
+                countingLanes |= 1ULL << lane;
+            }
+        }
+
+        u64 newSyncedLanes{ SimulateGridBatchIteration(batch, countingLanes) & batch.ActiveLanes & ~batch.SyncedLanes };
+        batch.SyncedLanes |= newSyncedLanes;
+        for (; newSyncedLanes != 0; newSyncedLanes &= newSyncedLanes - 1)
+        {
+            i32 lane{ CountTrailingZeros64(newSyncedLanes) };
+            results[batch.LaneGrids[lane]].SyncIteration = batch.LaneIterations[lane];
+        }
+
+        for (u64 lanes{ batch.ActiveLanes }; lanes != 0; lanes &= lanes - 1)
+        {
+            i32 lane{ CountTrailingZeros64(lanes) };
+            i32 iteration{ batch.LaneIterations[lane] };
+            bool isDone{ iteration >= maxIterationCount || (iteration >= K_SIMULATION_LENGTH && ((batch.SyncedLanes >> lane) & 1)) };
+            if (isDone)
+            {
+                results[batch.LaneGrids[lane]].FlashCounter = ReadLaneFlashCounter(batch, lane);
+                batch.ActiveLanes &= ~(1ULL << lane);
+                if (nextGrid < lastGrid)
+                {
+                    LoadGridIntoLane(batch, grids, nextGrid++, lane);
+                }
+            }
+        }
+    }
+}
+
+// Grids, which must all have the same size, are split into one contiguous range per thread, each
+// range being simulated 64 grids at a time.
+void SimulateGrids(const std::vector<Grid>& grids, std::vector<GridBatchResult>& results, i32 maxIterationCount, i32 threadCount)
+{
+    results.assign(grids.size(), {});
+    size_t gridsPerThread{ (grids.size() + threadCount - 1) / threadCount };
+
+    auto simulateRange{ [&grids, &results, gridsPerThread, maxIterationCount](i32 threadIndex)
+    {
+        size_t firstGrid{ std::min(grids.size(), threadIndex * gridsPerThread) };
+        size_t lastGrid{ std::min(grids.size(), firstGrid + gridsPerThread) };
+        SimulateGridRange(grids, firstGrid, lastGrid, results, maxIterationCount);
+    } };
+
+    std::vector<std::thread> workers{};
+    for (i32 threadIndex = 1; threadIndex < threadCount; ++threadIndex)
+    {
+        workers.emplace_back(simulateRange, threadIndex);
+    }
+    simulateRange(0);
+    for (std::thread& worker : workers)
+    {
+        worker.join();
+    }
+}
+
+// Windows consoles only interpret ANSI escape sequences once virtual terminal processing is on.
+void EnableAnsiColors()
+{
+#if defined(_WIN32)
+    HANDLE outputHandle{ GetStdHandle(STD_OUTPUT_HANDLE) };
+    DWORD consoleMode{};
+    if (GetConsoleMode(outputHandle, &consoleMode))
+    {
+        SetConsoleMode(outputHandle, consoleMode | ENABLE_VIRTUAL_TERMINAL_PROCESSING);
+    }
+#endif
+}
+
+// The frame is built in memory, with a colour change only where a run of flashed cells starts or
+// ends, and written with a single call.
 void DisplayGrid(const Grid& grid)
 {
-    HANDLE cout_handle = GetStdHandle(STD_OUTPUT_HANDLE);
+    static constexpr std::string_view flashedColor{ "\x1b[32m" };
+    static constexpr std::string_view defaultColor{ "\x1b[0m" };
 
+    fmt::memory_buffer frame{};
     for (i32 j = 0; j < grid.Height; ++j)
     {
+        bool isFlashedRun{};
         for (i32 i = 0; i < grid.Width; ++i)
         {
-            i32 cellIndex{ i + j * grid.Width };
-            if (grid.FlashState[cellIndex])
-            {
-                SetConsoleTextAttribute(cout_handle, FOREGROUND_GREEN);
-            }
-            else
+            u8 cell{ grid.Cells[i + j * grid.Width] };
+            if ((cell == 0) != isFlashedRun)
             {
-                SetConsoleTextAttribute(cout_handle, FOREGROUND_RED | FOREGROUND_GREEN | FOREGROUND_BLUE);
+                isFlashedRun = !isFlashedRun;
+                std::string_view color{ isFlashedRun ? flashedColor : defaultColor };
+                frame.append(color.data(), color.data() + color.size());
             }
-            fmt::print("{}", grid.Cells[cellIndex]);
+            frame.push_back((char)('0' + cell));
         }
-        SetConsoleTextAttribute(cout_handle, FOREGROUND_RED | FOREGROUND_GREEN | FOREGROUND_BLUE);
-        fmt::print("\n");
+        if (isFlashedRun)
+        {
+            frame.append(defaultColor.data(), defaultColor.data() + defaultColor.size());
+        }
+        frame.push_back('\n');
     }
+
+    std::fwrite(frame.data(), 1, frame.size(), stdout);
+}
+
+void PrintSimulationTime(const char* simulatorName, i32 stepCount, size_t cellCount, std::chrono::duration<double> simulationTime)
+{
+    double cellsPerSecond{ (double)cellCount * stepCount / simulationTime.count() };
+    fmt::print("{} simulation: {} steps in {:.3f} ms ({:.3e} cells/s).\n", simulatorName, stepCount, simulationTime.count() * 1000.0, cellsPerSecond);
 }
 
-int main()
+// Simulates random grids of the input size and summarises when they sync.
+void RunGridBatch(const Grid& inputGrid, i32 gridCount)
 {
+    std::mt19937 randomEngine{ K_BATCH_RANDOM_SEED };
+    std::uniform_int_distribution<int> levelDistribution{ 0, 9 };
+
+    std::vector<Grid> grids(gridCount);
+    for (Grid& grid : grids)
+    {
+        grid.Width = inputGrid.Width;
+        grid.Height = inputGrid.Height;
+        grid.Cells.resize(inputGrid.Cells.size());
+        for (u8& cell : grid.Cells)
+        {
+            cell = (u8)levelDistribution(randomEngine);
+        }
+    }
+
+    i32 threadCount{ std::thread::hardware_concurrency() > 0 ? (i32)std::thread::hardware_concurrency() : 1 };
+    std::vector<GridBatchResult> results{};
+    auto startTime{ std::chrono::steady_clock::now() };
+    SimulateGrids(grids, results, K_MAX_BATCH_ITERATION_COUNT, threadCount);
+    std::chrono::duration<double> simulationTime{ std::chrono::steady_clock::now() - startTime };
+
+    i32 syncedGridCount{};
+    i32 minSyncIteration{ K_MAX_BATCH_ITERATION_COUNT };
+    i32 maxSyncIteration{};
+    u64 totalSyncIteration{};
+    u64 totalFlashCounter{};
+    for (const GridBatchResult& result : results)
+    {
+        totalFlashCounter += result.FlashCounter;
+        if (result.SyncIteration != 0)
+        {
+            ++syncedGridCount;
+            totalSyncIteration += result.SyncIteration;
+            minSyncIteration = result.SyncIteration < minSyncIteration ? result.SyncIteration : minSyncIteration;
+            maxSyncIteration = result.SyncIteration > maxSyncIteration ? result.SyncIteration : maxSyncIteration;
+        }
+    }
+
+    fmt::print("Simulated {} grids in {:.3f} ms ({} threads).\n", gridCount, simulationTime.count() * 1000.0, threadCount);
+    fmt::print("Mean Flash Counter at {} steps: {:.1f}.\n", K_SIMULATION_LENGTH, (double)totalFlashCounter / gridCount);
+    fmt::print("Synced within {} steps: {} grids.\n", K_MAX_BATCH_ITERATION_COUNT, syncedGridCount);
+    if (syncedGridCount > 0)
+    {
+        fmt::print("Iteration Count To Sync: min {}, mean {:.1f}, max {}.\n", minSyncIteration, (double)totalSyncIteration / syncedGridCount, maxSyncIteration);
+    }
+}
+
+// In headless mode nothing is rendered and only the time spent simulating is reported, for the
+// simulator in use and for the other one replaying the same steps. --batch <count> simulates
+// that many random grids instead, and --steps <count> runs a long simulation skipping over cycles.
+int main(int argc, char** argv)
+{
+    bool isHeadless{ argc > 1 && std::strcmp(argv[1], "--headless") == 0 };
+
     Grid grid{};
     if (ReadInput(grid))
     {
+        if (argc > 2 && std::strcmp(argv[1], "--batch") == 0)
+        {
+            char* countEnd{};
+            long gridCount{ std::strtol(argv[2], &countEnd, 10) };
+            if (countEnd == argv[2] || *countEnd != '\0' || gridCount <= 0 || gridCount > K_MAX_BATCH_GRID_COUNT)
+            {
+                fmt::print("Grid count must be between 1 and {}.\n", K_MAX_BATCH_GRID_COUNT);
+                return -1;
+            }
+
+            RunGridBatch(grid, (i32)gridCount);
+            return 0;
+        }
+
+        if (argc > 2 && std::strcmp(argv[1], "--steps") == 0)
+        {
+            char* countEnd{};
+            errno = 0;
+            u64 iterationCount{ std::strtoull(argv[2], &countEnd, 10) };
+            if (!std::isdigit((unsigned char)argv[2][0]) || *countEnd != '\0' || errno == ERANGE)
+            {
+                fmt::print("Step count must be an unsigned 64-bit number.\n");
+                return -1;
+            }
+
+            LongSimulationReport report{};
+            SimulateLongHorizon(grid, iterationCount, report);
+            if (report.IsFlashCounterOverflowed)
+            {
+                fmt::print("Flash Counter at {} steps does not fit in 64 bits.\n", iterationCount);
+            }
+            else
+            {
+                fmt::print("Flash Counter at {} steps: {}.\n", iterationCount, report.FlashCounter);
+            }
+            fmt::print("Iteration Count To Sync: {}.\n", report.SyncIteration);
+            return report.IsFlashCounterOverflowed ? -1 : 0;
+        }
+
+        if (!isHeadless)
+        {
+            EnableAnsiColors();
+        }
+
+        // Narrow rows leave most bits of each word idle, where the worklist is faster.
+        bool isBitPlaneUsed{ grid.Width >= K_MIN_BIT_PLANE_WIDTH };
+        Grid initialGrid{ grid };
+        BitPlaneGrid bitPlaneGrid{};
+        if (isBitPlaneUsed)
+        {
+            BuildBitPlaneGrid(grid, bitPlaneGrid);
+        }
+
+        auto simulateIteration = [&]() { return isBitPlaneUsed ? SimulateBitPlaneIteration(bitPlaneGrid) : SimulateGridIteration(grid); };
+        auto displayGrid = [&]()
+        {
+            if (isBitPlaneUsed)
+            {
+                CopyBitPlaneGridCells(bitPlaneGrid, grid);
+            }
+            DisplayGrid(grid);
+        };
+
+        std::chrono::duration<double> simulationTime{};
+        auto startTime{ std::chrono::steady_clock::now() };
+
         i32 flashCounter{};
         for (i32 i = 0; i < K_SIMULATION_LENGTH; ++i)
         {
-            flashCounter += SimulateGridIteration(grid);
+            flashCounter += simulateIteration();
+        }
+
+        simulationTime += std::chrono::steady_clock::now() - startTime;
+        if (!isHeadless)
+        {
+            displayGrid();
         }
-        DisplayGrid(grid);
         fmt::print("Flash Counter at {} steps: {}.\n\n", K_SIMULATION_LENGTH, flashCounter);
+        startTime = std::chrono::steady_clock::now();
 
         i32 iterationCount{ K_SIMULATION_LENGTH };
         while (flashCounter != grid.Width * grid.Height)
         {
-            flashCounter = SimulateGridIteration(grid);
+            flashCounter = simulateIteration();
             ++iterationCount;
         }
 
-        DisplayGrid(grid);
+        simulationTime += std::chrono::steady_clock::now() - startTime;
+        if (!isHeadless)
+        {
+            displayGrid();
+        }
 
         fmt::print("Iteration Count To Sync: {}.\n", iterationCount);
+
+        if (isHeadless)
+        {
+            PrintSimulationTime(isBitPlaneUsed ? "Bit-plane" : "Worklist", iterationCount, grid.Cells.size(), simulationTime);
+
+            startTime = std::chrono::steady_clock::now();
+            if (isBitPlaneUsed)
+            {
+                for (i32 i = 0; i < iterationCount; ++i)
+                {
+                    SimulateGridIteration(initialGrid);
+                }
+            }
+            else
+            {
+                BuildBitPlaneGrid(initialGrid, bitPlaneGrid);
+                for (i32 i = 0; i < iterationCount; ++i)
+                {
+                    SimulateBitPlaneIteration(bitPlaneGrid);
+                }
+            }
+            PrintSimulationTime(isBitPlaneUsed ? "Worklist" : "Bit-plane", iterationCount, grid.Cells.size(), std::chrono::steady_clock::now() - startTime);
+        }
     }
     else
     {
-        fmt::print("Failed to open input file.\n");
+        fmt::print("Failed to read input file.\n");
     }
     return 0;
-}
\ No newline at end of file
+}
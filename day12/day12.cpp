@@ -6,18 +6,25 @@
 
 #include <fmt/core.h>
 
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
 using u32 = std::uint32_t;
+using u64 = std::uint64_t;
 using CaveID = std::uint64_t;
 
-static constexpr u32 u32Max{ std::numeric_limits<u32>::max() };
+static constexpr u32 K_MAX_SMALL_CAVE_COUNT{ 32 };
 
 static constexpr CaveID K_START_CAVE_ID{ 0x0000007472617473 };
 static constexpr CaveID K_END_CAVE_ID{ 0x0000000000646e65 };
 
+// SmallCaveBit is the bit of a small cave in visited cave masks, 0 for a big cave.
 struct Cave
 {
     std::vector<size_t> NearbyCaves;
     CaveID ID;
+    u32 SmallCaveBit{};
     bool IsSmall{};
 };
 
@@ -32,13 +39,24 @@ struct CaveNetwork
     std::vector<Cave> Caves;
     size_t StartIndex{};
     size_t EndIndex{};
+    u32 SmallCaveCount{};
 };
 
-struct Route
+// Big caves removed: EdgeCounts[from * CaveCount + to] is the number of ways to walk from one small
+// cave to another, directly or through a single big cave, including loops back to the same cave.
+struct SmallCaveGraph
 {
-    std::vector<size_t> CaveSequence{};
+    std::vector<u64> EdgeCounts;
+    std::vector<u32> NearbyCaveMasks;
+    u32 CaveCount{};
+    u32 StartIndex{};
+    u32 EndIndex{};
 };
 
+// Route counts from a small cave to the end, keyed by the cave, the small caves already visited and
+// whether a small cave was already visited twice.
+using RouteCountCache = std::unordered_map<u64, u64>;
+
 union CaveIDToText
 {
     CaveID ID;
@@ -105,7 +123,7 @@ void BuildCaveSet(std::unordered_map<CaveID, size_t>& caveIDs, const std::vector
     }
 }
 
-void BuildCaveList(std::vector<Cave>& caves, const std::unordered_map<CaveID, size_t>& caveIDs)
+void BuildCaveList(std::vector<Cave>& caves, u32& smallCaveCount, const std::unordered_map<CaveID, size_t>& caveIDs)
 {
     size_t caveCount{ caveIDs.size() };
     caves.resize(caveCount);
@@ -115,6 +133,16 @@ void BuildCaveList(std::vector<Cave>& caves, const std::unordered_map<CaveID, si
         caves[caveID.second].ID = caveID.first;
         caves[caveID.second].IsSmall = IsSmallCave(caveID.first);
     }
+
+    smallCaveCount = 0;
+    for (Cave& cave : caves)
+    {
+        if (cave.IsSmall)
+        {
+            cave.SmallCaveBit = smallCaveCount < K_MAX_SMALL_CAVE_COUNT ? 1U << smallCaveCount : 0;
+            ++smallCaveCount;
+        }
+    }
 }
 
 void ConnectCaves(std::vector<Cave>& caves, std::unordered_map<CaveID, size_t>& caveIDs, const std::vector<CaveConnection>& caveConnections)
@@ -132,80 +160,136 @@ void BuildCaveNetwork(CaveNetwork& caveNetwork, const std::vector<CaveConnection
 {
     std::unordered_map<CaveID, size_t> caveIDs{};
     BuildCaveSet(caveIDs, caveConnections);
-    BuildCaveList(caveNetwork.Caves, caveIDs);
+    BuildCaveList(caveNetwork.Caves, caveNetwork.SmallCaveCount, caveIDs);
     ConnectCaves(caveNetwork.Caves, caveIDs, caveConnections);
 
     caveNetwork.StartIndex = caveIDs[K_START_CAVE_ID];
     caveNetwork.EndIndex = caveIDs[K_END_CAVE_ID];
 }
 
-void VisitCave(size_t caveIndex,
-               u32 dualVisitCave,
-               std::vector<const Cave*>& caveSequence,
-               std::vector<u32>& visitCount,
-               std::vector<Route>& routes,
-               const CaveNetwork& caveNetwork)
+inline u32 CountTrailingZeros32(u32 bits)
 {
-    const Cave* currentCave{ &caveNetwork.Caves[caveIndex] };
-    caveSequence.push_back(currentCave);
+#if defined(_MSC_VER)
+    unsigned long index{};
+    _BitScanForward(&index, bits);
+    return (u32)index;
+#else
+    return (u32)__builtin_ctz(bits);
+#endif
+}
 
-    if (caveIndex == caveNetwork.EndIndex)
+// Fails when two big caves are connected, since routes could then bounce between them forever.
+bool BuildSmallCaveGraph(SmallCaveGraph& graph, const CaveNetwork& caveNetwork)
+{
+    const std::vector<Cave>& caves{ caveNetwork.Caves };
+    std::vector<u32> smallCaveIndices(caves.size());
+    for (size_t caveIndex{}; caveIndex < caves.size(); ++caveIndex)
     {
-        Route& newRoute{ routes.emplace_back() };
-        newRoute.CaveSequence.resize(caveSequence.size());
-
-        auto caveToID = [](const Cave* cave) { return cave->ID; };
-        std::transform(caveSequence.begin(), caveSequence.end(), newRoute.CaveSequence.begin(), caveToID);
+        const Cave& cave{ caves[caveIndex] };
+        if (cave.IsSmall)
+        {
+            smallCaveIndices[caveIndex] = CountTrailingZeros32(cave.SmallCaveBit);
+        }
+        else
+        {
+            for (size_t nearbyCaveIndex : cave.NearbyCaves)
+            {
+                if (!caves[nearbyCaveIndex].IsSmall)
+                {
+                    return false;
+                }
+            }
+        }
     }
-    else
-    {
-        ++visitCount[caveIndex];
 
-        for (size_t nearbyCaveID : currentCave->NearbyCaves)
+    graph.CaveCount = caveNetwork.SmallCaveCount;
+    graph.EdgeCounts.assign((size_t)graph.CaveCount * graph.CaveCount, 0);
+    graph.NearbyCaveMasks.assign(graph.CaveCount, 0);
+    graph.StartIndex = smallCaveIndices[caveNetwork.StartIndex];
+    graph.EndIndex = smallCaveIndices[caveNetwork.EndIndex];
+
+    for (size_t caveIndex{}; caveIndex < caves.size(); ++caveIndex)
+    {
+        const Cave& cave{ caves[caveIndex] };
+        if (cave.IsSmall)
         {
-            if (nearbyCaveID != caveNetwork.StartIndex)
+            u64* edgeCounts{ &graph.EdgeCounts[(size_t)smallCaveIndices[caveIndex] * graph.CaveCount] };
+            for (size_t nearbyCaveIndex : cave.NearbyCaves)
             {
-                const Cave* nearbyCave{ &caveNetwork.Caves[nearbyCaveID] };
-                if (nearbyCave->IsSmall)
+                if (caves[nearbyCaveIndex].IsSmall)
                 {
-                    if (visitCount[nearbyCaveID] == 0)
-                    {
-                        VisitCave(nearbyCaveID, dualVisitCave, caveSequence, visitCount, routes, caveNetwork);
-                    }
-                    else if (visitCount[nearbyCaveID] == 1 && dualVisitCave == u32Max)
-                    {
-                        VisitCave(nearbyCaveID, nearbyCaveID, caveSequence, visitCount, routes, caveNetwork);
-                    }
+                    ++edgeCounts[smallCaveIndices[nearbyCaveIndex]];
                 }
-                else
+            }
+        }
+        else
+        {
+            for (size_t entranceIndex : cave.NearbyCaves)
+            {
+                u64* edgeCounts{ &graph.EdgeCounts[(size_t)smallCaveIndices[entranceIndex] * graph.CaveCount] };
+                for (size_t exitIndex : cave.NearbyCaves)
                 {
-                    VisitCave(nearbyCaveID, dualVisitCave, caveSequence, visitCount, routes, caveNetwork);
+                    ++edgeCounts[smallCaveIndices[exitIndex]];
                 }
             }
         }
+    }
 
-        --visitCount[caveIndex];
+    for (u32 from{}; from < graph.CaveCount; ++from)
+    {
+        for (u32 to{}; to < graph.CaveCount; ++to)
+        {
+            if (graph.EdgeCounts[(size_t)from * graph.CaveCount + to] != 0 && to != graph.StartIndex)
+            {
+                graph.NearbyCaveMasks[from] |= 1U << to;
+            }
+        }
     }
 
-    caveSequence.pop_back();
+    return true;
 }
 
-void ComputeAllPossibleRoutes(std::vector<Route>& routes, const CaveNetwork& caveNetwork)
+u64 CountRoutesFrom(u32 caveIndex, u32 visitedCaves, bool isDualVisitUsed, RouteCountCache& cache, const SmallCaveGraph& graph)
 {
-    std::vector<const Cave*> caveSequence{};
-    std::vector<u32> visitCount(caveNetwork.Caves.size(), 0);
-    VisitCave(caveNetwork.StartIndex, u32Max, caveSequence, visitCount, routes, caveNetwork);
-}
+    if (caveIndex == graph.EndIndex)
+    {
+        return 1;
+    }
 
-void DisplayRoute(const Route& route)
-{
-    CaveIDToText converter{};
-    for (CaveID id : route.CaveSequence)
+    visitedCaves |= 1U << caveIndex;
+
+    u64 stateKey{ ((u64)caveIndex << 33) | ((u64)visitedCaves << 1) | (u64)isDualVisitUsed };
+    auto cachedCount{ cache.find(stateKey) };
+    if (cachedCount != cache.end())
+    {
+        return cachedCount->second;
+    }
+
+    const u64* edgeCounts{ &graph.EdgeCounts[(size_t)caveIndex * graph.CaveCount] };
+    u32 nearbyCaves{ graph.NearbyCaveMasks[caveIndex] };
+    u32 unvisitedCaves{ nearbyCaves & ~visitedCaves };
+    u32 revisitedCaves{ isDualVisitUsed ? 0U : nearbyCaves & visitedCaves };
+
+    u64 routeCount{};
+    for (; unvisitedCaves != 0; unvisitedCaves &= unvisitedCaves - 1)
     {
-        converter.ID = id;
-        fmt::print("{}-", converter.Text);
+        u32 nearbyCaveIndex{ CountTrailingZeros32(unvisitedCaves) };
+        routeCount += edgeCounts[nearbyCaveIndex] * CountRoutesFrom(nearbyCaveIndex, visitedCaves, isDualVisitUsed, cache, graph);
     }
-    fmt::print("\n");
+    for (; revisitedCaves != 0; revisitedCaves &= revisitedCaves - 1)
+    {
+        u32 nearbyCaveIndex{ CountTrailingZeros32(revisitedCaves) };
+        routeCount += edgeCounts[nearbyCaveIndex] * CountRoutesFrom(nearbyCaveIndex, visitedCaves, true, cache, graph);
+    }
+
+    cache[stateKey] = routeCount;
+    return routeCount;
+}
+
+u64 CountAllPossibleRoutes(const SmallCaveGraph& graph)
+{
+    RouteCountCache cache{};
+    return CountRoutesFrom(graph.StartIndex, 0, false, cache, graph);
 }
 
 int main()
@@ -216,14 +300,25 @@ int main()
         CaveNetwork network{};
         BuildCaveNetwork(network, caveConnections);
 
-        std::vector<Route> routes{};
-        ComputeAllPossibleRoutes(routes, network);
-        //std::for_each(routes.begin(), routes.end(), DisplayRoute);
-        fmt::print("Possible Route Count: {}.\n", routes.size());
+        if (network.SmallCaveCount > K_MAX_SMALL_CAVE_COUNT)
+        {
+            fmt::print("Too many small caves: {} (at most {}).\n", network.SmallCaveCount, K_MAX_SMALL_CAVE_COUNT);
+            return -1;
+        }
+
+        SmallCaveGraph graph{};
+        if (!BuildSmallCaveGraph(graph, network))
+        {
+            fmt::print("Two big caves are connected, the route count is unbounded.\n");
+            return -1;
+        }
+
+        u64 routeCount{ CountAllPossibleRoutes(graph) };
+        fmt::print("Possible Route Count: {}.\n", routeCount);
     }
     else
     {
         fmt::print("Failed to open input file.\n");
     }
     return 0;
-}
\ No newline at end of file
+}